@@ -0,0 +1,143 @@
+// Layout time of clusters nested 1 to 12 deep, with the built-in cluster (measure/arrange) and
+// with the same cluster as a user-defined kind laid out with compute_layout, on the null backend.
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <stdio.h>
+
+#define FRAMES 200
+#define WARMUP 20
+
+TextStyle text_style = { .color = {0, 0, 0, 255}, .font_size = 20 };
+u8 legacy_cluster_kind = 0;
+
+// The cluster as it was before measure/arrange
+LayoutResult legacy_cluster_layout(Element* el, void* data) {
+	Layout* layout = hui_layout(el);
+	Layout* parent_layout = hui_layout(hui_parent(el));
+	Pixels padding = *(Pixels*)data;
+	bool width_was_set_by_parent = !is_unset(layout->width);
+	bool height_was_set_by_parent = !is_unset(layout->height);
+
+	Pixels row_max_height = 0;
+	Pixels max_width = 0;
+	Pixels x = layout->x;
+	Pixels y = layout->y;
+
+	Pixels width_limit;
+	if (width_was_set_by_parent) {
+		width_limit = layout->width;
+	} else {
+		width_limit = parent_layout->width;
+		layout->width = parent_layout->width; // Temporary, for the children
+	}
+	if (!height_was_set_by_parent) {
+		layout->height = parent_layout->height; // Temporary, for the children
+	}
+
+	for (Element* child = hui_first_child(el); child != NULL; child = hui_next_sibling(child)) {
+		Layout* child_layout = hui_layout(child);
+		child_layout->x = x;
+		child_layout->y = y;
+		hui_compute_layout(child);
+
+		if (x + child_layout->width > layout->x + width_limit) {
+			// Advance a row
+			if (x - padding - layout->x > max_width) {
+				max_width = x - padding - layout->x;
+			}
+			y += row_max_height + padding;
+			x = layout->x;
+
+			child_layout->y = y;
+			child_layout->x = x;
+			row_max_height = 0;
+
+			if (child_layout->width > width_limit) {
+				child_layout->width = width_limit;
+				child_layout->height = UNSET;
+			}
+			hui_compute_layout(child);
+		}
+
+		if (child_layout->height > row_max_height) {
+			row_max_height = child_layout->height;
+		}
+		x += child_layout->width + padding;
+	}
+
+	if (!height_was_set_by_parent) {
+		layout->height = y + row_max_height - layout->y;
+	}
+	if (!width_was_set_by_parent) {
+		if (x - padding - layout->x > max_width) {
+			max_width = x - padding - layout->x;
+		}
+		layout->width = max_width;
+	}
+	return is_unset(layout->x) || is_unset(layout->y) ? LAYOUT_ASK_PARENT : LAYOUT_OK;
+}
+
+void legacy_cluster_draw(Element* el, void* data) {
+	(void) data;
+	for (Element* child = hui_first_child(el); child != NULL; child = hui_next_sibling(child)) {
+		hui_draw(child);
+	}
+}
+
+void cluster_start(bool legacy) {
+	if (!legacy) {
+		hui_cluster_start(5);
+		return;
+	}
+	Element* element = push_element(legacy_cluster_kind, sizeof(Pixels));
+	*(Pixels*)get_element_data(element) = 5;
+	start_adding_children();
+}
+
+void cluster_end(bool legacy) {
+	if (!legacy) {
+		hui_cluster_end();
+		return;
+	}
+	stop_adding_children();
+}
+
+void nest(bool legacy, i32 depth) {
+	cluster_start(legacy);
+		hui_text(STR("Some"), text_style);
+		hui_text(STR("words"), text_style);
+		if (depth > 1) nest(legacy, depth - 1);
+		hui_text(STR("to wrap"), text_style);
+	cluster_end(legacy);
+}
+
+f64 layout_ms(bool legacy, i32 depth) {
+	f64 total = 0;
+	for (i32 frame = 0; frame < FRAMES; frame++) {
+		hui_root_start();
+			nest(legacy, depth);
+		hui_root_end();
+		if (frame >= WARMUP) total += hui_get_stats().layout_ms;
+	}
+	return total / (FRAMES - WARMUP);
+}
+
+i32 main(void) {
+	hui_set_backend(hui_null_backend(200, 600));
+	hui_init();
+	legacy_cluster_kind = hui_register_element_kind((ElementKind) {
+		.compute_layout = legacy_cluster_layout,
+		.draw = legacy_cluster_draw,
+	});
+
+	printf("Nested clusters, layout ms per frame\n");
+	printf("depth  compute_layout  measure/arrange\n");
+	for (i32 depth = 1; depth <= 12; depth++) {
+		f64 legacy = layout_ms(true, depth);
+		f64 current = layout_ms(false, depth);
+		printf("%5d  %14.4f  %15.4f\n", depth, legacy, current);
+	}
+
+	hui_deinit();
+	return 0;
+}
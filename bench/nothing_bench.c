@@ -0,0 +1,35 @@
+// Per element cost of the layout and draw passes: a stack of 50000 hui_nothing on the null backend
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <stdio.h>
+
+#define ELEMENTS 50000
+#define FRAMES 90
+#define WARMUP 10
+
+i32 main(void) {
+	hui_set_backend(hui_null_backend(800, 600));
+	hui_init();
+
+	f64 layout = 0;
+	f64 draw = 0;
+	for (i32 frame = 0; frame < FRAMES; frame++) {
+		hui_root_start();
+			hui_stack_start(0);
+				for (i32 i = 0; i < ELEMENTS; i++) hui_nothing();
+			hui_stack_end();
+		hui_root_end();
+		if (frame < WARMUP) continue;
+		HUIStats stats = hui_get_stats();
+		layout += stats.layout_ms;
+		draw += stats.draw_ms;
+	}
+	layout /= FRAMES - WARMUP;
+	draw /= FRAMES - WARMUP;
+	printf("Stack of %d hui_nothing\n", ELEMENTS);
+	printf("layout: %.3f ms per frame, %.1f ns per element\n", layout, layout * 1e6 / ELEMENTS);
+	printf("draw:   %.3f ms per frame, %.1f ns per element\n", draw, draw * 1e6 / ELEMENTS);
+
+	hui_deinit();
+	return 0;
+}
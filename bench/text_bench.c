@@ -0,0 +1,46 @@
+// Throughput of text layout (populate_cache), bypassing the text cache, on the null backend: a
+// paragraph laid out many times, and 1 MB of log lines. Includes the library to reach populate_cache.
+#include "../hui/lib.c"
+#include <stdio.h>
+#include <time.h>
+
+str lorem = STR_ARR(
+	"Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nulla lobortis purus a metus luctus molestie. Fusce magna dui, aliquet eget eros nec, iaculis luctus turpis. Phasellus commodo, nunc id euismod suscipit, nisl orci posuere sapien, nec convallis magna arcu nec urna. Fusce eleifend lacinia purus. Mauris sagittis ex ut bibendum dapibus. Phasellus et velit nunc. Vestibulum iaculis elementum auctor. Donec eu ultricies tortor. Donec dictum est ligula, quis tincidunt risus elementum viverra. Vestibulum eu sodales tortor. Aenean porttitor est in ex semper tincidunt. Donec pretium nec risus ut lacinia. Integer sollicitudin velit augue."
+);
+
+#define LOG_SIZE (1 << 20)
+char log_text[LOG_SIZE];
+
+// In MB/s
+f64 layout_throughput(str text, Pixels width, i32 repetitions) {
+	HUITextCacheValue value = {0};
+	clock_t start = clock();
+	for (i32 i = 0; i < repetitions; i++) {
+		populate_cache(&value, text, 0, width, 0, 16, NULL);
+	}
+	f64 seconds = (f64)(clock() - start) / CLOCKS_PER_SEC;
+	hvec_free(&value.glyphs);
+	hvec_free(&value.text);
+	return (f64)text.len * repetitions / seconds / (1 << 20);
+}
+
+i32 main(void) {
+	hui_set_backend(hui_null_backend(800, 600));
+	hui_init();
+
+	usize len = 0;
+	for (usize line = 0;; line++) {
+		i32 written = snprintf(log_text + len, LOG_SIZE - len,
+			"2026-10-18T12:%02zu:%02zu.%03zu INFO worker[%zu] request id=%zx path=/api/v1/items status=200 bytes=%zu\n",
+			line/60%60, line%60, line%1000, line%8, line*2654435761u, line*37%4096);
+		if (written <= 0 || len + written >= LOG_SIZE) break;
+		len += written;
+	}
+	str log = { log_text, len };
+
+	printf("lorem (%zu B): %.1f MB/s\n", lorem.len, layout_throughput(lorem, 600, 20000));
+	printf("log (%zu B):  %.1f MB/s\n", log.len, layout_throughput(log, 1200, 20));
+
+	hui_deinit();
+	return 0;
+}
@@ -15,6 +15,7 @@ HHashMap hhashmap_new_with_cap(usize key_size, usize value_size, HKeyType type,
 
 	return (HHashMap) {
 		.len = 0,
+		.tombstones = 0,
 		.cap = cap,
 		.key_size = key_size,
 		.value_size = value_size,
@@ -54,8 +55,10 @@ bool hhashmap_next(HHashMap* map, void* out_key, void* out_value, usize* index)
 
 void hhashmap_set(HHashMap* map, void* key, void* value);
 // internal
+// Also drops the deleted entries, so it only grows if they were not most of them
 void hhashmap_grow(HHashMap* map) {
-	HHashMap new_map = hhashmap_new_with_cap(map->key_size, map->value_size, map->type, map->cap*2);
+	usize cap = 4*map->len > map->cap ? map->cap*2 : map->cap;
+	HHashMap new_map = hhashmap_new_with_cap(map->key_size, map->value_size, map->type, cap);
 	void* key;
 	void* value;
 	usize index = 0;
@@ -70,13 +73,14 @@ void hhashmap_grow(HHashMap* map) {
 }
 
 void hhashmap_set(HHashMap* map, void* key, void* value) {
-	if (4*map->len > 3*map->cap) { // A 0.75 load factor
+	if (4*(map->len + map->tombstones) > 3*map->cap) { // A 0.75 load factor
 		hhashmap_grow(map);
 	}
 	usize index = map->type.hash(key, map->key_size) % map->cap;
 
 	for(usize safety = 0; safety < map->len+1; safety++) {
 		if (!map->info[index].occupied || map->info[index].deleted) {
+			if (map->info[index].deleted) map->tombstones--;
 			map->info[index].occupied = true;
 			map->info[index].deleted = false;
 			memcpy((char*)map->keys + index*map->key_size, key, map->key_size);
@@ -100,7 +104,7 @@ int hhashmap_get_index(HHashMap* map, void* key) {
 			break;
 		}
 		if (map->info[index].deleted) {
-			index++;
+			index = (index + 1) % map->cap;
 			continue;
 		}
 		if (map->type.eq(key, (char*)map->keys + index*map->key_size, map->key_size)) {
@@ -130,6 +134,13 @@ void hhashmap_delete(HHashMap* map, void* key) {
 
 	map->info[index].deleted = true;
 	map->len--;
+	map->tombstones++;
+}
+
+void hhashmap_clear(HHashMap* map) {
+	memset(map->info, 0, map->cap*sizeof(EntryInfo));
+	map->len = 0;
+	map->tombstones = 0;
 }
 
 bool hkeytype_direct_eq(void* key1, void* key2, usize size) {
@@ -17,6 +17,7 @@ typedef struct EntryInfo {
 
 typedef struct HHashMap {
 	usize len;
+	usize tombstones; // Deleted entries, which still take a slot until the map grows
 	usize cap;
 	usize key_size;
 	usize value_size;
@@ -32,6 +33,7 @@ bool hhashmap_next(HHashMap* map, void* ret_key, void* ret_value, usize* index);
 void hhashmap_set(HHashMap* map, void* key, void* value);
 void* hhashmap_get(HHashMap* map, void* key);
 void hhashmap_delete(HHashMap* map, void* key);
+void hhashmap_clear(HHashMap* map); // Keeps the capacity
 void hhashmap_free(HHashMap* map);
 
 bool hkeytype_direct_eq(void* key1, void* key2, usize size);
@@ -40,6 +40,20 @@ void hvec_push(HVec* vec, void* element) {
 	vec->len++;
 }
 
+void* hvec_extend(HVec* vec, void* elements, usize count) {
+	if (vec->len + count > vec->cap) {
+		usize new_cap = vec->cap * 2;
+		if (new_cap < vec->len + count) new_cap = vec->len + count;
+		hvec_resize(vec, new_cap);
+	}
+	void* destination = (u8*)vec->data + vec->len*vec->element_size;
+	if (elements != NULL) {
+		memcpy(destination, elements, count*vec->element_size);
+	}
+	vec->len += count;
+	return destination;
+}
+
 void hvec_insert(HVec* vec, void* element, usize index) {
 	if (vec->len >= vec->cap) {
 		hvec_resize(vec, vec->cap * 2);
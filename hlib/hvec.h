@@ -13,6 +13,7 @@ typedef struct HVec {
 HVec hvec_new_with_cap(usize element_size, usize cap);
 HVec hvec_new(usize element_size);
 void hvec_push(HVec* vec, void* element);
+void* hvec_extend(HVec* vec, void* elements, usize count); // Returns the first new element. If elements is NULL, they are left uninitialized
 void hvec_insert(HVec* vec, void* element, usize index);
 void hvec_free(HVec* vec);
 void hvec_clear(HVec* vec);
@@ -0,0 +1,424 @@
+#include "hui.h"
+#include "core.c"
+#include "../hlib/hhashmap.h"
+#include <math.h>
+#include <pthread.h>
+
+// Glyphs are rasterized once per codepoint, font and font size, into a single texture shared by all
+// text, so drawing text does not need a texture per string and every glyph goes in the same batch.
+// Glyphs are packed in shelves (rows) of similar height. When the atlas is full, it is cleared,
+// and the glyphs still in use are rasterized again as they are drawn.
+// In SDF mode (see hui_set_sdf_text), glyphs go in another atlas, as signed distance fields
+// rasterized once at HUI_SDF_SIZE, and are scaled to any font size when drawn.
+// Both only store the alpha (R8), and the backend's shader tints it with the color of the text.
+// Glyphs are rasterized (and their distance fields computed) on worker threads, so a frame that shows
+// a lot of new text does not wait for them: a glyph is not drawn until it is ready, and the ready ones
+// are uploaded at the start of the next frames, at most HUI_ATLAS_UPLOAD_BUDGET bytes per frame.
+#define HUI_ATLAS_SIZE 1024
+#define HUI_ATLAS_PADDING 1 // Between glyphs, so that filtering does not bleed into the neighbours
+#define HUI_SDF_SIZE 48 // The font size the distance fields are computed at
+#define HUI_SDF_SPREAD 6 // How far from the edge distances are kept, in pixels at HUI_SDF_SIZE
+#define HUI_GLYPH_THREADS_DEFAULT 2
+#define HUI_GLYPH_THREADS_MAX 16
+#define HUI_ATLAS_UPLOAD_BUDGET (256 << 10) // Bytes, but at least one glyph per frame
+
+typedef struct {
+	int     codepoint;
+	Pixels  font_size; // HUI_SDF_SIZE in the SDF atlas
+	HUIFont font;
+} HUIGlyphKey;
+
+typedef struct {
+	Rectangle source; // In the atlas
+	Vector2   offset; // From the pen position
+} HUIGlyph;
+
+typedef struct {
+	Pixels y;
+	Pixels height;
+	Pixels x; // Where the next glyph goes
+} HUIAtlasShelf;
+
+typedef struct {
+	bool sdf;
+	Texture2D texture;
+	HHashMap glyphs; // HUIGlyphKey -> HUIGlyph
+	HVec shelves; // HUIAtlasShelf
+	HHashMap pending; // HUIGlyphKey -> bool, the glyphs given to the workers. Kept when cleared.
+	Pixels bottom; // Of the last shelf
+	u32 generation; // Changes when cleared, so that the glyphs looked up before are looked up again
+} HUIAtlas;
+
+typedef struct {
+	HUIAtlas* atlas;
+	HUIGlyphKey key;
+	Font font; // Looked up on the main thread, as fonts can be loaded meanwhile
+	Image pixels; // In the format of the atlas, set by glyph_rasterize
+	Vector2 offset;
+} HUIGlyphJob;
+
+// The workers take jobs from queued and put them in done, both under mutex
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t wake; // Jobs were queued, or the workers have to stop
+	pthread_t threads[HUI_GLYPH_THREADS_MAX];
+	usize running;
+	usize count; // Started when first needed. 0 rasterizes on the main thread.
+	bool stopping;
+	HVec queued; // HUIGlyphJob
+	usize queued_next; // The first one not taken yet
+	HVec done; // HUIGlyphJob
+} HUIGlyphWorkers;
+
+HUIAtlas glyph_atlas = { .sdf = false };
+HUIAtlas sdf_atlas = { .sdf = true };
+u32 atlas_generations = 0; // So that the generations of both atlases are never the same
+bool sdf_text = false;
+HUIGlyphWorkers glyph_workers = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.count = HUI_GLYPH_THREADS_DEFAULT,
+};
+
+void hui_set_sdf_text(bool enabled) {
+	sdf_text = enabled;
+}
+
+// The one text is drawn from
+HUIAtlas* text_atlas() {
+	HUIAtlas* atlas = sdf_text ? &sdf_atlas : &glyph_atlas;
+	if (atlas->texture.id == 0) {
+		atlas->texture = backend.load_alpha_texture(HUI_ATLAS_SIZE, HUI_ATLAS_SIZE, atlas->sdf);
+		stats.texture_loads++;
+		atlas->glyphs = hhashmap_new(sizeof(HUIGlyphKey), sizeof(HUIGlyph), HKEYTYPE_DIRECT);
+		atlas->shelves = hvec_new(sizeof(HUIAtlasShelf));
+		atlas->pending = hhashmap_new(sizeof(HUIGlyphKey), sizeof(bool), HKEYTYPE_DIRECT);
+		atlas->generation = ++atlas_generations;
+	}
+	return atlas;
+}
+
+// GPU memory of the atlases, and how much more they would take in RGBA
+usize atlas_bytes() {
+	usize bytes = 0;
+	if (glyph_atlas.texture.id != 0) bytes += HUI_ATLAS_SIZE*HUI_ATLAS_SIZE;
+	if (sdf_atlas.texture.id != 0) bytes += HUI_ATLAS_SIZE*HUI_ATLAS_SIZE;
+	return bytes;
+}
+
+usize atlas_bytes_saved() {
+	return 3*atlas_bytes();
+}
+
+void atlas_clear(HUIAtlas* atlas) {
+	// The glyphs drawn until now still use the old contents
+	draw_flush();
+	hhashmap_clear(&atlas->glyphs);
+	hvec_clear(&atlas->shelves);
+	atlas->bottom = 0;
+	atlas->generation = ++atlas_generations;
+}
+
+// Returns where a glyph of the given size fits, or false if the atlas is full.
+bool atlas_allocate(HUIAtlas* atlas, Pixels width, Pixels height, Vector2* position) {
+	width += HUI_ATLAS_PADDING;
+	height += HUI_ATLAS_PADDING;
+	for (usize i = 0; i < atlas->shelves.len; i++) {
+		HUIAtlasShelf* shelf = hvec_at(&atlas->shelves, i);
+		// Glyphs much shorter than the shelf would waste its space
+		if (shelf->height >= height && shelf->height <= height*1.25 + 2 && shelf->x + width <= HUI_ATLAS_SIZE) {
+			*position = (Vector2) { .x = shelf->x, .y = shelf->y };
+			shelf->x += width;
+			return true;
+		}
+	}
+	if (atlas->bottom + height > HUI_ATLAS_SIZE || width > HUI_ATLAS_SIZE) {
+		return false;
+	}
+	HUIAtlasShelf shelf = { .y = atlas->bottom, .height = height, .x = width };
+	hvec_push(&atlas->shelves, &shelf);
+	atlas->bottom += height;
+	*position = (Vector2) { .x = 0, .y = shelf.y };
+	return true;
+}
+
+#define HUI_SDF_FAR 1e20f
+
+// Squared distances to the nearest zero of f, in place, along a row or a column, with the lower
+// envelope of parabolas (Felzenszwalb and Huttenlocher). line, v and z have room for n (+1) values.
+void sdf_distance_1d(f32* f, usize n, usize stride, f32* line, int* v, f32* z) {
+	for (usize i = 0; i < n; i++) line[i] = f[i*stride];
+	int k = 0;
+	v[0] = 0;
+	z[0] = -HUI_SDF_FAR;
+	z[1] = HUI_SDF_FAR;
+	for (int q = 1; q < (int)n; q++) {
+		f32 s = ((line[q] + q*q) - (line[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+		while (s <= z[k]) { // Never for k = 0, as the distances are far smaller than HUI_SDF_FAR
+			k--;
+			s = ((line[q] + q*q) - (line[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = HUI_SDF_FAR;
+	}
+	k = 0;
+	for (int q = 0; q < (int)n; q++) {
+		while (z[k + 1] < q) k++;
+		f[q*stride] = (q - v[k])*(q - v[k]) + line[v[k]];
+	}
+}
+
+void sdf_distance_2d(f32* grid, usize width, usize height, f32* line, int* v, f32* z) {
+	for (usize x = 0; x < width; x++) sdf_distance_1d(grid + x, height, width, line, v, z);
+	for (usize y = 0; y < height; y++) sdf_distance_1d(grid + y*width, width, 1, line, v, z);
+}
+
+// The alpha of an RGBA image, as the backends rasterize glyphs
+Image coverage_from_rgba(Image rgba) {
+	Image coverage = { .data = NULL, .width = rgba.width, .height = rgba.height, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+	if (rgba.data == NULL) return coverage; // The null backend only has sizes
+	usize len = (usize)rgba.width*rgba.height;
+	u8* out = malloc(len);
+	nullpanic(out);
+	for (usize i = 0; i < len; i++) {
+		out[i] = ((u8*)rgba.data)[i*4 + 3];
+	}
+	coverage.data = out;
+	return coverage;
+}
+
+// From the coverage in the alpha of an RGBA image, to the distance to the edge in one channel:
+// 0.5 on the edge, 1 at HUI_SDF_SPREAD pixels inside and 0 at HUI_SDF_SPREAD outside.
+Image sdf_from_coverage(Image coverage) {
+	int spread = HUI_SDF_SPREAD;
+	usize width = coverage.width + 2*spread;
+	usize height = coverage.height + 2*spread;
+	Image sdf = { .data = NULL, .width = width, .height = height, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+	if (coverage.data == NULL) return sdf; // The null backend only has sizes
+	u8* in = coverage.data;
+	usize longest = width > height ? width : height;
+	// The squared distance of each pixel to the nearest one inside, and to the nearest one outside
+	f32* to_inside = malloc(2*width*height*sizeof(f32) + (2*longest + 1)*sizeof(f32) + longest*sizeof(int));
+	nullpanic(to_inside);
+	f32* to_outside = to_inside + width*height;
+	f32* line = to_outside + width*height;
+	f32* z = line + longest;
+	int* v = (int*)(z + longest + 1);
+	for (usize y = 0; y < height; y++) {
+		for (usize x = 0; x < width; x++) {
+			int cx = (int)x - spread;
+			int cy = (int)y - spread;
+			bool inside = cx >= 0 && cy >= 0 && cx < coverage.width && cy < coverage.height && in[(cy*coverage.width + cx)*4 + 3] >= 128;
+			to_inside[y*width + x] = inside ? 0 : HUI_SDF_FAR;
+			to_outside[y*width + x] = inside ? HUI_SDF_FAR : 0;
+		}
+	}
+	sdf_distance_2d(to_inside, width, height, line, v, z);
+	sdf_distance_2d(to_outside, width, height, line, v, z);
+
+	u8* out = malloc(width*height);
+	nullpanic(out);
+	for (usize i = 0; i < width*height; i++) {
+		// From the center of the nearest pixel on the other side, to the edge between them
+		f32 distance = to_outside[i] > 0 ? sqrtf(to_outside[i]) - 0.5 : -(sqrtf(to_inside[i]) - 0.5);
+		f32 value = 0.5 + distance / (2*spread);
+		out[i] = value <= 0 ? 0 : value >= 1 ? 255 : value*255;
+	}
+	free(to_inside);
+	sdf.data = out;
+	return sdf;
+}
+
+// Fills in the pixels and offset of the job. Called on the worker threads, so it only uses the
+// backend's rasterize_glyph and unload_image, and the job.
+void glyph_rasterize(HUIGlyphJob* job) {
+	HUIGlyphImage image = backend.rasterize_glyph(job->font, job->key.codepoint, job->key.font_size);
+	job->offset = image.offset;
+	job->pixels = (Image) {0};
+	if (image.image.width > 0 && image.image.height > 0) {
+		if (job->atlas->sdf) {
+			job->pixels = sdf_from_coverage(image.image);
+			job->offset.x -= HUI_SDF_SPREAD;
+			job->offset.y -= HUI_SDF_SPREAD;
+		} else {
+			job->pixels = coverage_from_rgba(image.image);
+		}
+	}
+	backend.unload_image(image.image);
+}
+
+void* glyph_worker(void* arg) {
+	(void) arg;
+	HUIGlyphWorkers* workers = &glyph_workers;
+	pthread_mutex_lock(&workers->mutex);
+	while (true) {
+		while (workers->queued_next == workers->queued.len && !workers->stopping) {
+			pthread_cond_wait(&workers->wake, &workers->mutex);
+		}
+		if (workers->queued_next == workers->queued.len) break; // Stopping, and all the jobs are done
+		HUIGlyphJob job = *(HUIGlyphJob*)hvec_at(&workers->queued, workers->queued_next++);
+		if (workers->queued_next == workers->queued.len) {
+			hvec_clear(&workers->queued);
+			workers->queued_next = 0;
+		}
+		pthread_mutex_unlock(&workers->mutex);
+		glyph_rasterize(&job);
+		pthread_mutex_lock(&workers->mutex);
+		hvec_push(&workers->done, &job);
+	}
+	pthread_mutex_unlock(&workers->mutex);
+	return NULL;
+}
+
+void glyph_workers_start() {
+	HUIGlyphWorkers* workers = &glyph_workers;
+	if (workers->queued.element_size == 0) {
+		workers->queued = hvec_new(sizeof(HUIGlyphJob));
+		workers->done = hvec_new(sizeof(HUIGlyphJob));
+	}
+	workers->stopping = false;
+	for (; workers->running < workers->count; workers->running++) {
+		if (pthread_create(&workers->threads[workers->running], NULL, glyph_worker, NULL) != 0) {
+			panic("Could not start a glyph worker");
+		}
+	}
+}
+
+// Waits for the jobs already queued, which are uploaded as usual
+void glyph_workers_stop() {
+	HUIGlyphWorkers* workers = &glyph_workers;
+	if (workers->running == 0) return;
+	pthread_mutex_lock(&workers->mutex);
+	workers->stopping = true;
+	pthread_cond_broadcast(&workers->wake);
+	pthread_mutex_unlock(&workers->mutex);
+	for (usize i = 0; i < workers->running; i++) {
+		pthread_join(workers->threads[i], NULL);
+	}
+	workers->running = 0;
+}
+
+void hui_set_glyph_threads(usize count) {
+	glyph_workers_stop();
+	glyph_workers.count = count < HUI_GLYPH_THREADS_MAX ? count : HUI_GLYPH_THREADS_MAX;
+}
+
+// Puts the rasterized glyph in the atlas, on the main thread
+HUIGlyph atlas_add(HUIAtlas* atlas, HUIGlyphJob* job) {
+	stats.glyphs_rasterized++;
+	Image pixels = job->pixels;
+	HUIGlyph glyph = { .source = {0}, .offset = job->offset };
+	if (pixels.width > 0 && pixels.height > 0) {
+		Vector2 position;
+		if (!atlas_allocate(atlas, pixels.width, pixels.height, &position)) {
+			atlas_clear(atlas);
+			if (!atlas_allocate(atlas, pixels.width, pixels.height, &position)) {
+				panic("Glyph does not fit in the atlas");
+			}
+		}
+		glyph.source = (Rectangle) { .x = position.x, .y = position.y, .width = pixels.width, .height = pixels.height };
+		backend.update_texture(atlas->texture, glyph.source, pixels);
+	}
+	free(pixels.data);
+	hhashmap_set(&atlas->glyphs, &job->key, &glyph);
+	return glyph;
+}
+
+// Returns false if the glyph is not rasterized yet. It is then given to the workers, and is ready
+// once atlas_upload put it in the atlas.
+bool atlas_glyph(HUIAtlas* atlas, HUIFont font, int codepoint, Pixels font_size, HUIGlyph* glyph) {
+	if (atlas->sdf) font_size = HUI_SDF_SIZE;
+	HUIGlyphKey key = { .codepoint = codepoint, .font_size = font_size, .font = font };
+	HUIGlyph* found = hhashmap_get(&atlas->glyphs, &key);
+	if (found != NULL) {
+		*glyph = *found;
+		return true;
+	}
+
+	HUIGlyphJob job = { .atlas = atlas, .key = key, .font = backend_font(font) };
+	if (glyph_workers.count == 0) {
+		glyph_rasterize(&job);
+		*glyph = atlas_add(atlas, &job);
+		return true;
+	}
+	if (hhashmap_get(&atlas->pending, &key) == NULL) {
+		bool pending = true;
+		hhashmap_set(&atlas->pending, &key, &pending);
+		if (glyph_workers.running < glyph_workers.count) glyph_workers_start();
+		pthread_mutex_lock(&glyph_workers.mutex);
+		hvec_push(&glyph_workers.queued, &job);
+		pthread_cond_signal(&glyph_workers.wake);
+		pthread_mutex_unlock(&glyph_workers.mutex);
+	}
+	return false;
+}
+
+// Called at the start of the draw pass, so the glyphs uploaded are drawn in this frame
+void atlas_upload() {
+	HUIGlyphWorkers* workers = &glyph_workers;
+	if (workers->done.element_size == 0) return;
+	usize bytes = 0;
+	while (bytes < HUI_ATLAS_UPLOAD_BUDGET) {
+		pthread_mutex_lock(&workers->mutex);
+		bool any = workers->done.len > 0;
+		HUIGlyphJob job;
+		if (any) {
+			job = *(HUIGlyphJob*)hvec_at(&workers->done, workers->done.len - 1);
+			workers->done.len--;
+		}
+		pthread_mutex_unlock(&workers->mutex);
+		if (!any) break;
+		HUIAtlas* atlas = job.atlas;
+		hhashmap_delete(&atlas->pending, &job.key);
+		atlas_add(atlas, &job);
+		bytes += (usize)job.pixels.width*job.pixels.height;
+	}
+}
+
+// Glyphs not drawn in this frame because they are not rasterized yet
+usize atlas_pending() {
+	usize pending = 0;
+	if (glyph_atlas.texture.id != 0) pending += glyph_atlas.pending.len;
+	if (sdf_atlas.texture.id != 0) pending += sdf_atlas.pending.len;
+	return pending;
+}
+
+void atlas_draw_glyph(HUIAtlas* atlas, HUIGlyph glyph, Vector2 position, Pixels font_size, Color color) {
+	if (glyph.source.width == 0) return;
+	f32 scale = atlas->sdf ? font_size / HUI_SDF_SIZE : 1;
+	Rectangle dest = {
+		.x = position.x + glyph.offset.x*scale,
+		.y = position.y + glyph.offset.y*scale,
+		.width = glyph.source.width*scale,
+		.height = glyph.source.height*scale,
+	};
+	draw_alpha_texture(atlas->texture, glyph.source, dest, color, atlas->sdf);
+}
+
+void atlas_free_one(HUIAtlas* atlas) {
+	if (atlas->texture.id == 0) return;
+	backend.unload_texture(atlas->texture);
+	atlas->texture = (Texture2D) {0};
+	hhashmap_free(&atlas->glyphs);
+	hvec_free(&atlas->shelves);
+	hhashmap_free(&atlas->pending);
+	atlas->bottom = 0;
+}
+
+void atlas_free() {
+	glyph_workers_stop();
+	if (glyph_workers.done.element_size != 0) {
+		for (usize i = 0; i < glyph_workers.done.len; i++) {
+			free(((HUIGlyphJob*)glyph_workers.done.data)[i].pixels.data);
+		}
+		hvec_free(&glyph_workers.queued);
+		hvec_free(&glyph_workers.done);
+		glyph_workers.queued = (HVec) {0};
+		glyph_workers.done = (HVec) {0};
+		glyph_workers.queued_next = 0;
+	}
+	atlas_free_one(&glyph_atlas);
+	atlas_free_one(&sdf_atlas);
+}
@@ -0,0 +1,312 @@
+#include "hui.h"
+#include "core.c"
+#include <raylib.h>
+#include <rlgl.h>
+
+// raylib
+
+Size hui_raylib_screen_size() {
+	return (Size) { .width = GetScreenWidth(), .height = GetScreenHeight() };
+}
+
+bool hui_raylib_key_pressed_with_repetition(int key) {
+	return IsKeyPressed(key) || IsKeyPressedRepeat(key);
+}
+
+void hui_raylib_input(HUIInput* input) {
+	*input = (HUIInput) {
+		.mouse = GetMousePosition(),
+		.wheel = GetMouseWheelMoveV(),
+		.mouse_pressed = IsMouseButtonPressed(MOUSE_BUTTON_LEFT),
+		.mouse_released = IsMouseButtonReleased(MOUSE_BUTTON_LEFT),
+		.keys = (hui_raylib_key_pressed_with_repetition(KEY_BACKSPACE) ? HUI_KEY_BACKSPACE : 0)
+			| (hui_raylib_key_pressed_with_repetition(KEY_LEFT) ? HUI_KEY_LEFT : 0)
+			| (hui_raylib_key_pressed_with_repetition(KEY_RIGHT) ? HUI_KEY_RIGHT : 0),
+		.key_pressed = GetKeyPressed(),
+		.char_pressed = GetCharPressed(),
+		.frame_time = GetFrameTime(),
+	};
+}
+
+Font hui_raylib_font(Font font) {
+	return font.glyphs == NULL ? GetFontDefault() : font;
+}
+
+Font hui_raylib_load_font(const char* path, int size) {
+	return LoadFontEx(path, size, NULL, 0);
+}
+
+Pixels hui_raylib_glyph_advance(Font font, int codepoint, Pixels font_size) {
+	font = hui_raylib_font(font);
+	int index = GetGlyphIndex(font, codepoint);
+	Pixels advance = font.glyphs[index].advanceX ? font.glyphs[index].advanceX : font.recs[index].width;
+	return advance * font_size/(f32)font.baseSize;
+}
+
+// Scaled the same way DrawTextCodepoint does, without filtering
+HUIGlyphImage hui_raylib_rasterize_glyph(Font font, int codepoint, Pixels font_size) {
+	font = hui_raylib_font(font);
+	int index = GetGlyphIndex(font, codepoint);
+	f32 scale_factor = font_size/(f32)font.baseSize;
+	Image image = ImageCopy(font.glyphs[index].image);
+	ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	ImageResizeNN(&image, font.recs[index].width*scale_factor, font.recs[index].height*scale_factor);
+	return (HUIGlyphImage) {
+		.image = image,
+		.offset = { .x = font.glyphs[index].offsetX*scale_factor, .y = font.glyphs[index].offsetY*scale_factor },
+	};
+}
+
+Texture2D hui_raylib_load_alpha_texture(int width, int height, bool smooth) {
+	Image image = GenImageColor(width, height, BLANK);
+	ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+	Texture2D texture = LoadTextureFromImage(image);
+	UnloadImage(image);
+	if (smooth) SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+	return texture;
+}
+
+void hui_raylib_update_texture(Texture2D texture, Rectangle rect, Image image) {
+	// Anything already batched must be drawn with the old contents
+	rlDrawRenderBatchActive();
+	UpdateTextureRec(texture, rect, image.data);
+}
+
+void hui_raylib_draw_rectangle(Rectangle rect, Color color) {
+	DrawRectangle(rect.x, rect.y, rect.width, rect.height, color);
+}
+
+void hui_raylib_draw_texture(Texture2D texture, Rectangle source, Rectangle dest, Color tint) {
+	DrawTexturePro(texture, source, dest, (Vector2) {0}, 0, tint);
+}
+
+// The shaders of HUIShader. GLSL 330 for desktop OpenGL 3.3 (which Mesa's llvmpipe also provides),
+// 100 for OpenGL ES 2 and 120 for OpenGL 2.1. Only the computation of the alpha differs.
+const char* hui_shader_header_330 =
+	"#version 330\n"
+	"in vec2 fragTexCoord;\n"
+	"in vec4 fragColor;\n"
+	"out vec4 finalColor;\n"
+	"#define SAMPLE texture\n"
+	"#define FRAG_COLOR finalColor\n";
+
+const char* hui_shader_header_120 =
+	"varying vec2 fragTexCoord;\n"
+	"varying vec4 fragColor;\n"
+	"#define SAMPLE texture2D\n"
+	"#define FRAG_COLOR gl_FragColor\n";
+
+const char* hui_shader_alpha =
+	"	float alpha = SAMPLE(texture0, fragTexCoord).r;\n";
+
+// The edge is smoothed over about a pixel on screen, whatever the scale
+const char* hui_shader_sdf =
+	"	float distance = SAMPLE(texture0, fragTexCoord).r;\n"
+	"	float smoothing = 0.7*fwidth(distance);\n"
+	"	float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);\n";
+
+// Loaded when first used, and kept as long as the OpenGL context
+Shader hui_raylib_shaders[3] = {0}; // By HUIShader
+
+Shader hui_raylib_load_shader(const char* alpha) {
+	const char* version;
+	const char* header = hui_shader_header_120;
+	switch (rlGetVersion()) {
+		case RL_OPENGL_ES_20:
+			version = "#version 100\n#extension GL_OES_standard_derivatives : enable\nprecision mediump float;\n";
+			break;
+		case RL_OPENGL_11:
+		case RL_OPENGL_21:
+			version = "#version 120\n";
+			break;
+		default:
+			version = "";
+			header = hui_shader_header_330;
+			break;
+	}
+	char source[1024];
+	snprintf(source, sizeof(source),
+		"%s%s"
+		"uniform sampler2D texture0;\n"
+		"uniform vec4 colDiffuse;\n"
+		"void main() {\n"
+		"%s"
+		"	FRAG_COLOR = vec4(fragColor.rgb, fragColor.a*alpha)*colDiffuse;\n"
+		"}\n",
+		version, header, alpha);
+	return LoadShaderFromMemory(NULL, source);
+}
+
+void hui_raylib_set_shader(HUIShader shader) {
+	if (shader == HUI_SHADER_NONE) {
+		EndShaderMode();
+		return;
+	}
+	if (hui_raylib_shaders[shader].id == 0) {
+		hui_raylib_shaders[shader] = hui_raylib_load_shader(shader == HUI_SHADER_SDF ? hui_shader_sdf : hui_shader_alpha);
+	}
+	BeginShaderMode(hui_raylib_shaders[shader]);
+}
+
+void hui_raylib_begin_scissor(Rectangle rect) {
+	BeginScissorMode(rect.x, rect.y, rect.width, rect.height);
+}
+
+// raylib can only wait for events without a timeout (EnableEventWaiting). With one, it sleeps until
+// the timeout and polls events, but at most this long at a time so that input is not seen late.
+#define HUI_RAYLIB_MAX_SLEEP 0.05
+
+bool hui_raylib_wait_events(f64 timeout) {
+	if (timeout < 0) {
+		EnableEventWaiting();
+		PollInputEvents();
+		DisableEventWaiting();
+	} else {
+		WaitTime(timeout < HUI_RAYLIB_MAX_SLEEP ? timeout : HUI_RAYLIB_MAX_SLEEP);
+		PollInputEvents();
+	}
+	return IsWindowResized() || WindowShouldClose();
+}
+
+HUIBackend hui_raylib_backend() {
+	return (HUIBackend) {
+		.screen_size = hui_raylib_screen_size,
+		.input = hui_raylib_input,
+		.load_font = hui_raylib_load_font,
+		.unload_font = UnloadFont,
+		.glyph_advance = hui_raylib_glyph_advance,
+		.rasterize_glyph = hui_raylib_rasterize_glyph,
+		.unload_image = UnloadImage,
+		.load_alpha_texture = hui_raylib_load_alpha_texture,
+		.unload_texture = UnloadTexture,
+		.update_texture = hui_raylib_update_texture,
+		.draw_rectangle = hui_raylib_draw_rectangle,
+		.draw_rectangle_lines = DrawRectangleLinesEx,
+		.draw_texture = hui_raylib_draw_texture,
+		.set_shader = hui_raylib_set_shader,
+		.begin_scissor = hui_raylib_begin_scissor,
+		.end_scissor = EndScissorMode,
+		.time = GetTime,
+		.wait_events = hui_raylib_wait_events,
+	};
+}
+
+// Null: no window, no input, and drawing does nothing.
+// Glyphs are monospaced, so text is measured the same on every machine.
+// Time is simulated: a frame passes at each input, and waiting passes its timeout at once.
+
+Size hui_null_screen = {0};
+f64 hui_null_clock = 0;
+
+Size hui_null_screen_size() {
+	return hui_null_screen;
+}
+
+void hui_null_input(HUIInput* input) {
+	*input = (HUIInput) { .mouse = { .x = -1, .y = -1 }, .frame_time = 1/60.0 };
+	hui_null_clock += input->frame_time;
+}
+
+f64 hui_null_time() {
+	return hui_null_clock;
+}
+
+// Without a timeout nothing would ever wake it up, so it returns as if the window had changed
+bool hui_null_wait_events(f64 timeout) {
+	if (timeout < 0) return true;
+	hui_null_clock += timeout;
+	return false;
+}
+
+Font hui_null_load_font(const char* path, int size) {
+	(void) path;
+	return (Font) { .baseSize = size };
+}
+
+void hui_null_unload_font(Font font) {
+	(void) font;
+}
+
+Pixels hui_null_glyph_advance(Font font, int codepoint, Pixels font_size) {
+	(void) font;
+	(void) codepoint;
+	return font_size/2;
+}
+
+// Only the size, so that the glyphs still take space in the atlas
+HUIGlyphImage hui_null_rasterize_glyph(Font font, int codepoint, Pixels font_size) {
+	(void) font;
+	(void) codepoint;
+	return (HUIGlyphImage) { .image = { .width = font_size/2, .height = font_size }, .offset = {0} };
+}
+
+void hui_null_unload_image(Image image) {
+	(void) image;
+}
+
+Texture2D hui_null_load_alpha_texture(int width, int height, bool smooth) {
+	(void) smooth;
+	return (Texture2D) { .id = 1, .width = width, .height = height };
+}
+
+void hui_null_unload_texture(Texture2D texture) {
+	(void) texture;
+}
+
+void hui_null_update_texture(Texture2D texture, Rectangle rect, Image image) {
+	(void) texture;
+	(void) rect;
+	(void) image;
+}
+
+void hui_null_end() {}
+
+void hui_null_draw_rectangle(Rectangle rect, Color color) {
+	(void) rect;
+	(void) color;
+}
+
+void hui_null_draw_rectangle_lines(Rectangle rect, Pixels thickness, Color color) {
+	(void) rect;
+	(void) thickness;
+	(void) color;
+}
+
+void hui_null_draw_texture(Texture2D texture, Rectangle source, Rectangle dest, Color tint) {
+	(void) texture;
+	(void) source;
+	(void) dest;
+	(void) tint;
+}
+
+void hui_null_set_shader(HUIShader shader) {
+	(void) shader;
+}
+
+void hui_null_begin_scissor(Rectangle rect) {
+	(void) rect;
+}
+
+HUIBackend hui_null_backend(Pixels width, Pixels height) {
+	hui_null_screen = (Size) { .width = width, .height = height };
+	return (HUIBackend) {
+		.screen_size = hui_null_screen_size,
+		.input = hui_null_input,
+		.load_font = hui_null_load_font,
+		.unload_font = hui_null_unload_font,
+		.glyph_advance = hui_null_glyph_advance,
+		.rasterize_glyph = hui_null_rasterize_glyph,
+		.unload_image = hui_null_unload_image,
+		.load_alpha_texture = hui_null_load_alpha_texture,
+		.unload_texture = hui_null_unload_texture,
+		.update_texture = hui_null_update_texture,
+		.draw_rectangle = hui_null_draw_rectangle,
+		.draw_rectangle_lines = hui_null_draw_rectangle_lines,
+		.draw_texture = hui_null_draw_texture,
+		.set_shader = hui_null_set_shader,
+		.begin_scissor = hui_null_begin_scissor,
+		.end_scissor = hui_null_end,
+		.time = hui_null_time,
+		.wait_events = hui_null_wait_events,
+	};
+}
@@ -6,80 +6,617 @@
 #include <time.h>
 #include "../hlib/core.h"
 #include "../hlib/hvec.h"
-#include "../hlib/harena.h"
+#include "../hlib/hhashmap.h"
 
 #include "hui.h"
 
-Element default_element = {
-	.id = 0,
-	.parent = NULL,
-	.first_child = NULL,
-	.next_sibling = NULL,
-	.prev_sibling = NULL,
-	.layout = { .x = UNSET, .y = UNSET, .width = UNSET, .height = UNSET },
-	.compute_layout = NULL,
-	.draw = NULL,
-};
-
-HArena element_arena = {0};
+// Everything built in a frame. See the Element struct in hui.h.
+typedef struct {
+	HVec elements; // Element
+	HVec layouts; // Layout
+	HVec layout_caches; // LayoutCache
+	HVec data; // u8, the data of every element, 8 byte aligned
+	HHashMap memos; // ElementId -> u32 index of the memo element
+} HUIFrame;
+
+// Double buffered, so that the previous frame's tree is still alive while building
+// the current one, and memoized subtrees can be copied from it (see memo.c).
+HUIFrame frames[2] = {0};
+usize current_frame_index = 0;
+HUIFrame* current_frame = &frames[0];
 HVec functions_vec = {0};
+HUIBackend backend = {0}; // See hui_set_backend
+HUIInput frame_input = {0};
+
+// The layout and draw passes use these instead of recursing, so that the depth of the tree
+// is not limited by the C stack.
+HVec measure_stack = {0}; // HUIMeasureFrame, see hui_measure
+bool arranging = false;
+HVec draw_stack = {0}; // u32, the elements whose children are being drawn
+
+typedef enum {
+	HUI_DRAW_RECTANGLE,
+	HUI_DRAW_RECTANGLE_LINES,
+	HUI_DRAW_TEXTURE,
+	HUI_DRAW_ALPHA_TEXTURE, // Scaled, with HUI_SHADER_ALPHA
+	HUI_DRAW_SDF_TEXTURE, // Scaled, with HUI_SHADER_SDF
+	HUI_DRAW_BEGIN_SCISSOR,
+	HUI_DRAW_END_SCISSOR,
+} HUIDrawKind;
+
+// The draw pass records these, and they are sent to the backend at the end of it,
+// grouped by texture, see draw.c.
+typedef struct {
+	u8        kind;
+	Color     color;
+	Rectangle rect; // Where it is drawn
+	Rectangle source; // Texture only
+	Pixels    thickness; // Rectangle lines only
+	Texture2D texture;
+} HUIDrawCommand;
+
+typedef struct {
+	u32       texture; // Id, 0 for shapes
+	u32       start; // Into draw_order, once sorted
+} HUIDrawBatch;
+
+HVec draw_commands = {0}; // HUIDrawCommand
+HVec draw_batches = {0}; // HUIDrawBatch, see draw_flush
+HVec draw_order = {0}; // u32, indices into draw_commands
+HVec draw_grid = {0}; // u32, see draw_flush
+HVec scissor_stack = {0}; // Rectangle, already intersected, see hui_begin_scissor
+
+HUIStats stats = {0};
+HUIStats last_frame_stats = {0};
+
+typedef enum {
+	HUI_VISIBLE         = 1 << 0, // Some of the element is inside of its clip
+	HUI_SUBTREE_VISIBLE = 1 << 1, // Some of it, or of its descendants
+	HUI_INTERACTIVE     = 1 << 2, // It has handlers
+	HUI_HOVERED         = 1 << 3, // See compute_hovered
+} HUIElementFlags;
+
+HVec visible_rects = {0}; // Rectangle, see compute_visibility
+HVec element_flags = {0}; // u8, HUIElementFlags
+HVec hit_bounds = {0}; // Rectangle, see compute_visibility
+HVec hit_stack = {0}; // u32
+
+// Returns the new element, uninitialized. Unlike hvec_push, this can be inlined.
+void* stack_push(HVec* stack) {
+	if (stack->len == stack->cap) {
+		return hvec_extend(stack, NULL, 1);
+	}
+	return (u8*)stack->data + stack->len++ * stack->element_size;
+}
+
+HVec bounding_box_stack = {0}; // u32, the elements clipping the ones being built
+
+u32 bounding_box_top() {
+	return ((u32*)bounding_box_stack.data)[bounding_box_stack.len - 1];
+}
+
+// Built-in kinds are dispatched with a switch instead of through function pointers,
+// so that the small ones can be inlined. User kinds are registered after these.
+typedef enum {
+	HUI_KIND_NONE,
+	HUI_KIND_ROOT,
+	HUI_KIND_STACK,
+	HUI_KIND_BOX,
+	HUI_KIND_CENTER,
+	HUI_KIND_CLUSTER,
+	HUI_KIND_LEFTRIGHT,
+	HUI_KIND_FIXED,
+	HUI_KIND_SCROLL,
+	HUI_KIND_VIRTUAL_LIST,
+	HUI_KIND_TEXT,
+	HUI_KIND_CURSOR_TEXT,
+	HUI_KIND_BLOCK,
+	HUI_KIND_NOTHING,
+	HUI_KIND_MEMO,
+	HUI_KIND_BUILTIN_COUNT,
+} HUIBuiltinKind;
+
+// A measure in progress, see hui_measure.
+// Built-in layouts measure their children through measure_child. If a child has children of its
+// own, the layout returns, and is called again with the child's size once it has been measured,
+// so that measuring does not recurse.
+typedef struct {
+	Element*    element;
+	Constraints constraints;
+	u32         step; // 0 in the first call, the rest is up to the kind
+	Element*    child; // The child being measured
+	Size        size; // The result, set with measure_done
+	union {
+		Pixels height; // stack
+		struct { Pixels x, y, row_max_height, max_width; bool row_empty; } cluster;
+		Size   left; // leftright
+	} state;
+} HUIMeasureFrame;
+
+void measure_done(HUIMeasureFrame* frame, Size size) {
+	frame->size = size;
+}
+
+// Defined in the other files of the library
+void hui_root_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_root_arrange(Element* el, void* data);
+void hui_stack_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_stack_arrange(Element* el, void* data);
+void hui_box_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_box_arrange(Element* el, void* data);
+void hui_box_draw(Element* el, void* data);
+void hui_center_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_center_arrange(Element* el, void* data);
+void hui_cluster_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_cluster_arrange(Element* el, void* data);
+void hui_leftright_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_leftright_arrange(Element* el, void* data);
+void hui_fixed_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_fixed_arrange(Element* el, void* data);
+void hui_scroll_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_scroll_arrange(Element* el, void* data);
+void hui_scroll_draw(Element* el, void* data);
+void hui_scroll_draw_end(Element* el, void* data);
+void hui_virtual_list_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_virtual_list_arrange(Element* el, void* data);
+Size hui_text_measure(Element* el, Constraints constraints, void* data);
+void hui_text_draw(Element* el, void* data);
+Size hui_cursor_text_measure(Element* el, Constraints constraints, void* data);
+void hui_cursor_text_draw(Element* el, void* data);
+Size hui_block_measure(Element* el, Constraints constraints, void* data);
+void hui_block_draw(Element* el, void* data);
+Size hui_nothing_measure(Element* el, Constraints constraints, void* data);
+void hui_leaf_arrange(Element* el, void* data);
+void hui_memo_measure(HUIMeasureFrame* frame, Size child_size, void* data);
+void hui_memo_arrange(Element* el, void* data);
+void draw_flush();
+void draw_alpha_texture(Texture2D texture, Rectangle source, Rectangle dest, Color tint, bool sdf);
+void atlas_upload();
+usize atlas_pending();
+void atlas_free();
+void text_cache_free();
+void fonts_free();
+Font backend_font(HUIFont font);
 
-#define BOUNDING_BOX_STACK_CAP 10
-Layout* bounding_box_stack[BOUNDING_BOX_STACK_CAP] = {0};
-usize bounding_box_stack_len = 0;
+ElementKind element_kinds[256] = {0};
+usize element_kinds_len = HUI_KIND_BUILTIN_COUNT;
 
-Element* root;
+u8 hui_register_element_kind(ElementKind kind) {
+	assert(element_kinds_len < 256);
+	element_kinds[element_kinds_len] = kind;
+	return element_kinds_len++;
+}
+
+u32 parent = HUI_NO_ELEMENT; // At most, one of these two is not HUI_NO_ELEMENT.
+u32 prev_sibling = HUI_NO_ELEMENT;
+
+Element* element_at(u32 index) {
+	if (index == HUI_NO_ELEMENT) return NULL;
+	return (Element*)current_frame->elements.data + index;
+}
+
+u32 element_index(Element* element) {
+	return element - (Element*)current_frame->elements.data;
+}
+
+Layout* hui_layout(Element* element) {
+	return (Layout*)current_frame->layouts.data + element_index(element);
+}
+
+LayoutCache* layout_cache(Element* element) {
+	return (LayoutCache*)current_frame->layout_caches.data + element_index(element);
+}
+
+// The part of its bounding box that is visible, so inside of all of the outer ones.
+// Only known after layout, see compute_visibility.
+Layout* hui_bounding_box(Element* element) {
+	return (Layout*)visible_rects.data + element->bounding_box;
+}
 
+Element* hui_parent(Element* element) {
+	return element_at(element->parent);
+}
+
+Element* hui_first_child(Element* element) {
+	return element_at(element->first_child);
+}
 
-Element* parent; // At most, one of these two is not NULL.
-Element* prev_sibling;
+Element* hui_next_sibling(Element* element) {
+	return element_at(element->next_sibling);
+}
 
 Element* current_element() {
-	if (parent) return parent;
-	return prev_sibling;
+	if (parent != HUI_NO_ELEMENT) return element_at(parent);
+	return element_at(prev_sibling);
 }
 
 ElementId hot_id = 0;
 ElementId active_id = 0;
 
-LayoutResult hui_root_layout(Element* el, void* data) {
+void hui_root_arrange(Element* el, void* data) {
 	(void) data;
-	if(!el->first_child || el->first_child->next_sibling) {
-		panic("Root must have exactly one child");
+	Layout* layout = hui_layout(el);
+	hui_arrange(hui_first_child(el), layout->x, layout->y);
+}
+
+bool is_legacy(Element* element) {
+	return element->kind >= HUI_KIND_BUILTIN_COUNT && element_kinds[element->kind].measure == NULL;
+}
+
+// Built-in layouts with children use kind_measure_step instead
+Size kind_measure(Element* element, Constraints constraints) {
+	void* data = get_element_data(element);
+	switch (element->kind) {
+		case HUI_KIND_TEXT:        return hui_text_measure(element, constraints, data);
+		case HUI_KIND_CURSOR_TEXT: return hui_cursor_text_measure(element, constraints, data);
+		case HUI_KIND_BLOCK:       return hui_block_measure(element, constraints, data);
+		case HUI_KIND_NOTHING:     return hui_nothing_measure(element, constraints, data);
+		default:                   return element_kinds[element->kind].measure(element, constraints, data);
 	}
-	Element* child = el->first_child;
-	child->layout = el->layout;
-	child->compute_layout(child, child+1);
-	return LAYOUT_OK;
 }
 
-void hui_root_draw(Element* el, void* data) {
-	(void) data;
-	Element* child = el->first_child;
-	while(child != NULL) {
-		child->draw(child, child+1);
-		child = child->next_sibling;
+bool has_measure_step(Element* element) {
+	switch (element->kind) {
+		case HUI_KIND_ROOT:
+		case HUI_KIND_STACK:
+		case HUI_KIND_BOX:
+		case HUI_KIND_CENTER:
+		case HUI_KIND_CLUSTER:
+		case HUI_KIND_LEFTRIGHT:
+		case HUI_KIND_FIXED:
+		case HUI_KIND_SCROLL:
+		case HUI_KIND_VIRTUAL_LIST:
+		case HUI_KIND_MEMO:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void kind_measure_step(HUIMeasureFrame* frame, Size child_size) {
+	void* data = get_element_data(frame->element);
+	switch (frame->element->kind) {
+		case HUI_KIND_ROOT:      hui_root_measure(frame, child_size, data); break;
+		case HUI_KIND_STACK:     hui_stack_measure(frame, child_size, data); break;
+		case HUI_KIND_BOX:       hui_box_measure(frame, child_size, data); break;
+		case HUI_KIND_CENTER:    hui_center_measure(frame, child_size, data); break;
+		case HUI_KIND_CLUSTER:   hui_cluster_measure(frame, child_size, data); break;
+		case HUI_KIND_LEFTRIGHT: hui_leftright_measure(frame, child_size, data); break;
+		case HUI_KIND_FIXED:     hui_fixed_measure(frame, child_size, data); break;
+		case HUI_KIND_SCROLL:    hui_scroll_measure(frame, child_size, data); break;
+		case HUI_KIND_VIRTUAL_LIST: hui_virtual_list_measure(frame, child_size, data); break;
+		case HUI_KIND_MEMO:      hui_memo_measure(frame, child_size, data); break;
+		default:                 panic("Not a built-in layout");
 	}
 }
 
+// Arrange only positions the children, which are arranged afterwards.
+void kind_arrange(Element* element) {
+	void* data = get_element_data(element);
+	switch (element->kind) {
+		case HUI_KIND_ROOT:        hui_root_arrange(element, data); break;
+		case HUI_KIND_STACK:       hui_stack_arrange(element, data); break;
+		case HUI_KIND_BOX:         hui_box_arrange(element, data); break;
+		case HUI_KIND_CENTER:      hui_center_arrange(element, data); break;
+		case HUI_KIND_CLUSTER:     hui_cluster_arrange(element, data); break;
+		case HUI_KIND_LEFTRIGHT:   hui_leftright_arrange(element, data); break;
+		case HUI_KIND_FIXED:       hui_fixed_arrange(element, data); break;
+		case HUI_KIND_SCROLL:      hui_scroll_arrange(element, data); break;
+		case HUI_KIND_VIRTUAL_LIST: hui_virtual_list_arrange(element, data); break;
+		case HUI_KIND_TEXT:
+		case HUI_KIND_CURSOR_TEXT:
+		case HUI_KIND_BLOCK:
+		case HUI_KIND_NOTHING:     hui_leaf_arrange(element, data); break;
+		case HUI_KIND_MEMO:        hui_memo_arrange(element, data); break;
+		default:                   element_kinds[element->kind].arrange(element, data); break;
+	}
+}
+
+// Built-in kinds only draw themselves, their children are drawn by hui_draw afterwards.
+void kind_draw(Element* element) {
+	void* data = get_element_data(element);
+	switch (element->kind) {
+		case HUI_KIND_BOX:         hui_box_draw(element, data); break;
+		case HUI_KIND_SCROLL:
+		case HUI_KIND_VIRTUAL_LIST: hui_scroll_draw(element, data); break;
+		case HUI_KIND_TEXT:        hui_text_draw(element, data); break;
+		case HUI_KIND_CURSOR_TEXT: hui_cursor_text_draw(element, data); break;
+		case HUI_KIND_BLOCK:       hui_block_draw(element, data); break;
+		default:                   break;
+	}
+}
+
+// Called once the children have been drawn
+void kind_draw_end(Element* element) {
+	switch (element->kind) {
+		case HUI_KIND_SCROLL:
+		case HUI_KIND_VIRTUAL_LIST: hui_scroll_draw_end(element, get_element_data(element)); break;
+		default:              break;
+	}
+}
+
+// The index after the last descendant, as subtrees are contiguous.
+u32 subtree_end(Element* element) {
+	for (; element != NULL; element = hui_parent(element)) {
+		if (element->next_sibling != HUI_NO_ELEMENT) return element->next_sibling;
+	}
+	return current_frame->elements.len;
+}
+
+u32 draw_stack_top() {
+	return ((u32*)draw_stack.data)[draw_stack.len - 1];
+}
+
 typedef struct {
 	void (*handler)(Element*, void*);
-	Element* element;
+	u32 element;
+	bool hover; // Only called when the element is hovered, see push_hover_handler
 } Handler;
 
-void push_handler(void (*handler)(Element*, void*), Element* el) {
-	Handler handler_struct = {.handler = handler, .element = el};
+void add_handler(void (*handler)(Element*, void*), Element* el, bool hover) {
+	Handler handler_struct = {.handler = handler, .element = element_index(el), .hover = hover};
 	hvec_push(&functions_vec, &handler_struct);
 }
 
+// Called every frame, as long as some of the element's subtree is visible
+void push_handler(void (*handler)(Element*, void*), Element* el) {
+	add_handler(handler, el, false);
+}
+
+// Called only when the element is hovered, or is hot or active, so that most of the widgets of a
+// large UI are not called at all
+void push_hover_handler(void (*handler)(Element*, void*), Element* el) {
+	add_handler(handler, el, true);
+}
+
+Rectangle rectangle_intersection(Rectangle a, Rectangle b) {
+	Pixels x0 = a.x > b.x ? a.x : b.x;
+	Pixels y0 = a.y > b.y ? a.y : b.y;
+	Pixels x1 = a.x + a.width < b.x + b.width ? a.x + a.width : b.x + b.width;
+	Pixels y1 = a.y + a.height < b.y + b.height ? a.y + a.height : b.y + b.height;
+	if (x1 <= x0 || y1 <= y0) return (Rectangle) { .x = x0, .y = y0, .width = 0, .height = 0 };
+	return (Rectangle) { .x = x0, .y = y0, .width = x1 - x0, .height = y1 - y0 };
+}
+
+Rectangle rectangle_union(Rectangle a, Rectangle b) {
+	if (a.width <= 0 || a.height <= 0) return b;
+	if (b.width <= 0 || b.height <= 0) return a;
+	Pixels x0 = a.x < b.x ? a.x : b.x;
+	Pixels y0 = a.y < b.y ? a.y : b.y;
+	Pixels x1 = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+	Pixels y1 = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+	return (Rectangle) { .x = x0, .y = y0, .width = x1 - x0, .height = y1 - y0 };
+}
+
+// Computed once after layout, so that the handlers and the draw pass skip the subtrees that can not
+// be seen. An element is clipped by its bounding box, which is clipped by its own, and so on, so the
+// visible rect of an element is its layout inside of the visible rect of its bounding box.
+// Children can be outside of their parent, so a subtree is only skipped if none of it is visible.
+// The hit bounds of an element contain the visible interactive elements of its subtree, see compute_hovered.
+void compute_visibility() {
+	usize len = current_frame->elements.len;
+	Element* elements = current_frame->elements.data;
+	Layout* layouts = current_frame->layouts.data;
+	hvec_clear(&visible_rects);
+	hvec_clear(&element_flags);
+	hvec_clear(&hit_bounds);
+	Rectangle* rects = hvec_extend(&visible_rects, NULL, len);
+	u8* flags = hvec_extend(&element_flags, NULL, len);
+	Rectangle* bounds = hvec_extend(&hit_bounds, NULL, len);
+	rects[0] = layouts[0];
+	flags[0] = HUI_VISIBLE | HUI_SUBTREE_VISIBLE;
+	bounds[0] = (Rectangle) {0};
+	for (usize i = 1; i < len; i++) {
+		// The bounding box comes before the elements it clips
+		rects[i] = rectangle_intersection(layouts[i], rects[elements[i].bounding_box]);
+		flags[i] = rects[i].width > 0 && rects[i].height > 0 ? HUI_VISIBLE | HUI_SUBTREE_VISIBLE : 0;
+		bounds[i] = (Rectangle) {0};
+	}
+	for (usize i = 0; i < functions_vec.len; i++) {
+		u32 index = ((Handler*)functions_vec.data)[i].element;
+		flags[index] |= HUI_INTERACTIVE;
+		if (flags[index] & HUI_VISIBLE) bounds[index] = rects[index];
+	}
+	for (usize i = len - 1; i > 0; i--) {
+		if (!(flags[i] & HUI_SUBTREE_VISIBLE)) continue;
+		u32 parent_index = elements[i].parent;
+		flags[parent_index] |= HUI_SUBTREE_VISIBLE;
+		if (bounds[i].width > 0) bounds[parent_index] = rectangle_union(bounds[parent_index], bounds[i]);
+	}
+	stats.elements_built = len;
+}
+
+u8 get_element_flags(Element* element) {
+	return ((u8*)element_flags.data)[element_index(element)];
+}
+
+bool hui_hovered(Element* element) {
+	return get_element_flags(element) & HUI_HOVERED;
+}
+
+// The mouse is hit tested once per frame, instead of by each handler. The tree is the spatial index:
+// only the subtrees whose hit bounds (see compute_visibility) contain the mouse are searched.
+// Elements are drawn in preorder, so the topmost hit is the last one. It and its ancestors under the
+// mouse are hovered.
+void compute_hovered() {
+	Element* elements = current_frame->elements.data;
+	Rectangle* rects = visible_rects.data;
+	u8* flags = element_flags.data;
+	Rectangle* bounds = hit_bounds.data;
+	Vector2 mouse = frame_input.mouse;
+	u32 hovered = HUI_NO_ELEMENT;
+	hvec_clear(&hit_stack);
+	if (CheckCollisionPointRec(mouse, bounds[0])) *(u32*)stack_push(&hit_stack) = 0;
+	while (hit_stack.len > 0) {
+		u32 index = ((u32*)hit_stack.data)[--hit_stack.len];
+		if ((flags[index] & HUI_INTERACTIVE) && CheckCollisionPointRec(mouse, rects[index])
+			&& (hovered == HUI_NO_ELEMENT || index > hovered)) {
+			hovered = index;
+		}
+		for (u32 child = elements[index].first_child; child != HUI_NO_ELEMENT; child = elements[child].next_sibling) {
+			if (CheckCollisionPointRec(mouse, bounds[child])) *(u32*)stack_push(&hit_stack) = child;
+		}
+	}
+	for (u32 index = hovered; index != HUI_NO_ELEMENT; index = elements[index].parent) {
+		if (CheckCollisionPointRec(mouse, rects[index])) flags[index] |= HUI_HOVERED;
+	}
+}
+
+// Elements are stored in the order they are drawn, so this is a loop over the subtree,
+// with a stack only to know when the children of an element have all been drawn.
+// Subtrees that can not be seen are skipped, see compute_visibility.
+// User-defined kinds draw their own children (by calling this).
+void hui_draw(Element* element) {
+	usize base = draw_stack.len;
+	u32 end = subtree_end(element);
+	u32 index = element_index(element);
+	u8* flags = element_flags.data;
+	while (index < end) {
+		Element* el = element_at(index);
+		while (draw_stack.len > base && draw_stack_top() != el->parent) {
+			kind_draw_end(element_at(draw_stack_top()));
+			draw_stack.len--;
+		}
+		if (!(flags[index] & HUI_SUBTREE_VISIBLE)) {
+			index = subtree_end(el);
+			continue;
+		}
+		if (el->kind >= HUI_KIND_BUILTIN_COUNT) {
+			// It may draw through raylib directly, so the recorded commands must be drawn first
+			draw_flush();
+			stats.elements_drawn++;
+			element_kinds[el->kind].draw(el, get_element_data(el));
+			index = subtree_end(el);
+			continue;
+		}
+		// A scroll that can not be seen has no visible descendants, so it never has to be ended
+		if (flags[index] & HUI_VISIBLE) {
+			kind_draw(el);
+			stats.elements_drawn++;
+		}
+		if (el->first_child != HUI_NO_ELEMENT) {
+			*(u32*)stack_push(&draw_stack) = index;
+		} else if (flags[index] & HUI_VISIBLE) {
+			// An empty scroll or virtual list still began a scissor
+			kind_draw_end(el);
+		}
+		index++;
+	}
+	while (draw_stack.len > base) {
+		kind_draw_end(element_at(draw_stack_top()));
+		draw_stack.len--;
+	}
+}
+
+void hui_set_backend(HUIBackend new_backend) {
+	backend = new_backend;
+}
+
+HUIInput hui_get_input() {
+	return frame_input;
+}
+
+// Idle mode, see hui_wait
+bool redraw_requested = true; // The first frame is always drawn
+f64 redraw_at = -1; // Backend time of the next timed redraw, negative if there is none
+bool input_waited = false; // frame_input was taken by hui_wait, for the next frame
+usize frames_since_wait = 2;
+f32 active_frame_time = 1/60.0; // Of the last frame not slowed by a wait
+Vector2 last_mouse = {0};
+
+void hui_request_redraw() {
+	redraw_requested = true;
+}
+
+void hui_request_redraw_in(f64 seconds) {
+	f64 at = backend.time() + seconds;
+	if (redraw_at < 0 || at < redraw_at) redraw_at = at;
+}
+
+f64 hui_get_time() {
+	return backend.time();
+}
+
+bool input_arrived(HUIInput* input) {
+	return input->mouse.x != last_mouse.x || input->mouse.y != last_mouse.y
+		|| input->wheel.x != 0 || input->wheel.y != 0
+		|| input->mouse_pressed || input->mouse_released
+		|| input->keys != 0 || input->key_pressed != 0 || input->char_pressed != 0;
+}
+
+// Blocks until a frame has to be drawn: input arrived, the window changed, hui_request_redraw was
+// called, or a timed redraw is due. The input that woke it up is the next frame's.
+void hui_wait() {
+	if (redraw_requested) return;
+	// The input that arrived while the last frame was built and drawn was already polled by the
+	// backend, and waiting polls again, which would drop it
+	backend.input(&frame_input);
+	input_waited = true;
+	if (input_arrived(&frame_input)) return;
+	while (!redraw_requested) {
+		f64 now = backend.time();
+		if (redraw_at >= 0 && now >= redraw_at) return;
+		bool window_changed = backend.wait_events(redraw_at < 0 ? -1 : redraw_at - now);
+		backend.input(&frame_input);
+		input_waited = true;
+		frames_since_wait = 0;
+		if (window_changed || input_arrived(&frame_input)) return;
+	}
+}
+
 void hui_init() {
-	element_arena = harena_new_with_cap(1024*4);
+	if (backend.screen_size == NULL) {
+		backend = hui_raylib_backend();
+	}
+	for (usize i = 0; i < 2; i++) {
+		frames[i] = (HUIFrame) {
+			.elements = hvec_new_with_cap(sizeof(Element), 1024),
+			.layouts = hvec_new_with_cap(sizeof(Layout), 1024),
+			.layout_caches = hvec_new_with_cap(sizeof(LayoutCache), 1024),
+			.data = hvec_new_with_cap(sizeof(u8), 1024*16),
+			.memos = hhashmap_new(sizeof(ElementId), sizeof(u32), HKEYTYPE_DIRECT),
+		};
+	}
 	functions_vec = hvec_new_with_cap(sizeof(Handler), 1024);
+	measure_stack = hvec_new_with_cap(sizeof(HUIMeasureFrame), 64);
+	draw_stack = hvec_new_with_cap(sizeof(u32), 64);
+	draw_commands = hvec_new_with_cap(sizeof(HUIDrawCommand), 1024);
+	draw_batches = hvec_new_with_cap(sizeof(HUIDrawBatch), 256);
+	draw_order = hvec_new_with_cap(sizeof(u32), 1024);
+	draw_grid = hvec_new_with_cap(sizeof(u32), 256);
+	scissor_stack = hvec_new_with_cap(sizeof(Rectangle), 16);
+	bounding_box_stack = hvec_new_with_cap(sizeof(u32), 16);
+	visible_rects = hvec_new_with_cap(sizeof(Rectangle), 1024);
+	element_flags = hvec_new_with_cap(sizeof(u8), 1024);
+	hit_bounds = hvec_new_with_cap(sizeof(Rectangle), 1024);
+	hit_stack = hvec_new_with_cap(sizeof(u32), 64);
 }
 
 void hui_deinit() {
-	if(element_arena.sarenas_used > 0) harena_free(&element_arena);
+	for (usize i = 0; i < 2; i++) {
+		if (frames[i].elements.data == NULL) continue;
+		hvec_free(&frames[i].elements);
+		hvec_free(&frames[i].layouts);
+		hvec_free(&frames[i].layout_caches);
+		hvec_free(&frames[i].data);
+		hhashmap_free(&frames[i].memos);
+	}
 	if(functions_vec.data != NULL) hvec_free(&functions_vec);
+	if(measure_stack.data != NULL) hvec_free(&measure_stack);
+	if(draw_stack.data != NULL) hvec_free(&draw_stack);
+	if(draw_commands.data != NULL) hvec_free(&draw_commands);
+	if(draw_batches.data != NULL) hvec_free(&draw_batches);
+	if(draw_order.data != NULL) hvec_free(&draw_order);
+	if(draw_grid.data != NULL) hvec_free(&draw_grid);
+	if(scissor_stack.data != NULL) hvec_free(&scissor_stack);
+	if(bounding_box_stack.data != NULL) hvec_free(&bounding_box_stack);
+	if(visible_rects.data != NULL) hvec_free(&visible_rects);
+	if(element_flags.data != NULL) hvec_free(&element_flags);
+	if(hit_bounds.data != NULL) hvec_free(&hit_bounds);
+	if(hit_stack.data != NULL) hvec_free(&hit_stack);
+	atlas_free();
+	text_cache_free();
+	fonts_free();
 }
 
 i64 frame_num = 0;
@@ -87,161 +624,451 @@ i64 hui_get_frame_num() {
 	return frame_num;
 }
 
+HUIStats hui_get_stats() {
+	return last_frame_stats;
+}
+
 bool is_unset(Pixels value) {
 	return value < 0;
 }
 
+Pixels constraints_width(Constraints constraints) {
+	return is_unset(constraints.width) ? constraints.max_width : constraints.width;
+}
+
+Pixels constraints_height(Constraints constraints) {
+	return is_unset(constraints.height) ? constraints.max_height : constraints.height;
+}
+
 void hui_root_start() {
-	root = harena_alloc(&element_arena, sizeof(Element));
-	root->layout = (Layout) { .x = 0, .y = 0, .width = GetScreenWidth(), .height = GetScreenHeight() };
-	root->parent = NULL;
-	root->next_sibling = NULL;
-	root->prev_sibling = NULL;
-	root->first_child = NULL;
-	root->compute_layout = hui_root_layout;
-	root->draw = hui_root_draw;
-
-	bounding_box_stack_len = 1;
-	bounding_box_stack[0] = &root->layout;
+	// The frame of two frames ago is reused, the last frame's one is kept for memoization
+	current_frame_index = 1 - current_frame_index;
+	current_frame = &frames[current_frame_index];
+	hvec_clear(&current_frame->elements);
+	hvec_clear(&current_frame->layouts);
+	hvec_clear(&current_frame->layout_caches);
+	hvec_clear(&current_frame->data);
+	hhashmap_clear(&current_frame->memos);
+
+	Element root = {
+		.id = 0,
+		.parent = HUI_NO_ELEMENT,
+		.first_child = HUI_NO_ELEMENT,
+		.next_sibling = HUI_NO_ELEMENT,
+		.bounding_box = 0,
+		.data = 0,
+		.kind = HUI_KIND_ROOT,
+	};
+	Size screen = backend.screen_size();
+	Layout layout = { .x = 0, .y = 0, .width = screen.width, .height = screen.height };
+	LayoutCache cache = { .valid = false };
+	hvec_push(&current_frame->elements, &root);
+	hvec_push(&current_frame->layouts, &layout);
+	hvec_push(&current_frame->layout_caches, &cache);
+
+	hvec_clear(&bounding_box_stack);
+	*(u32*)stack_push(&bounding_box_stack) = 0;
 
 	frame_num++;
+	redraw_requested = false;
+	redraw_at = -1;
+	stats = (HUIStats) {0};
 
-	parent = root;
+	parent = 0;
+	prev_sibling = HUI_NO_ELEMENT;
 }
 
-f32 frame_time;
 void hui_root_end() {
-	frame_time = GetFrameTime();
+	if (!input_waited) backend.input(&frame_input);
+	input_waited = false;
+	// The backend measures a frame at its end, and reports it in the next one, so a wait shows in
+	// the two frames after it
+	if (frames_since_wait < 2) {
+		frame_input.frame_time = active_frame_time;
+		frames_since_wait++;
+	} else {
+		active_frame_time = frame_input.frame_time;
+	}
+	// Handlers run after the frame is built, so what they change is only seen in the next one
+	if (input_arrived(&frame_input)) hui_request_redraw();
+	last_mouse = frame_input.mouse;
 
+	Element* root = element_at(0);
 	clock_t layout_start = clock();
-	root->compute_layout(root, root+1);
+	Pixels width = hui_layout(root)->width;
+	Pixels height = hui_layout(root)->height;
+	hui_measure(root, (Constraints) { .width = width, .height = height, .max_width = width, .max_height = height });
+	hui_arrange(root, 0, 0);
 	clock_t layout_end = clock();
 
+	compute_visibility();
+
 	clock_t handle_start = clock();
+	compute_hovered();
 	for(usize i = 0; i < functions_vec.len; i++) {
 		Handler* handler = (Handler*)hvec_at(&functions_vec, i);
-		handler->handler(handler->element, handler->element+1);
+		Element* element = element_at(handler->element);
+		// Unless it has to let go of being hot or active
+		bool interacting = element->id != 0 && (element->id == hot_id || element->id == active_id);
+		u8 needed = handler->hover ? HUI_HOVERED : HUI_SUBTREE_VISIBLE;
+		if (!(get_element_flags(element) & needed) && !interacting) {
+			stats.handlers_skipped++;
+			continue;
+		}
+		handler->handler(element, get_element_data(element));
 	}
 	clock_t handle_end = clock();
 
 	clock_t draw_start = clock();
-	root->draw(root, root+1);
+	atlas_upload();
+	hui_draw(root);
+	assert(scissor_stack.len == 0);
+	draw_flush();
+	stats.glyphs_pending = atlas_pending();
+	if (stats.glyphs_pending > 0) hui_request_redraw();
 	clock_t draw_end = clock();
 
-	harena_clear(&element_arena);
 	hvec_clear(&functions_vec);
 
-	printf("Layout: %f ms, Handle: %f ms, Draw: %f ms\n", (double)(layout_end - layout_start) / CLOCKS_PER_SEC * 1000, (double)(handle_end - handle_start) / CLOCKS_PER_SEC * 1000, (double)(draw_end - draw_start) / CLOCKS_PER_SEC * 1000);
+	stats.layout_ms = (f64)(layout_end - layout_start) / CLOCKS_PER_SEC * 1000;
+	stats.handle_ms = (f64)(handle_end - handle_start) / CLOCKS_PER_SEC * 1000;
+	stats.draw_ms = (f64)(draw_end - draw_start) / CLOCKS_PER_SEC * 1000;
+	last_frame_stats = stats;
+
+#ifdef HUI_PRINT_STATS
+	printf("Layout: %f ms (%lu calls, %lu cache hits, %lu arranged), Handle: %f ms (%lu skipped), Draw: %f ms (%lu of %lu elements, %lu commands, %lu batches, %lu glyphs rasterized, %lu pending, %lu textures loaded)\n", stats.layout_ms, stats.layout_calls, stats.layout_cache_hits, stats.arrange_calls, stats.handle_ms, stats.handlers_skipped, stats.draw_ms, stats.elements_drawn, stats.elements_built, stats.draw_commands, stats.draw_batches, stats.glyphs_rasterized, stats.glyphs_pending, stats.texture_loads);
+#endif
 }
 
 void* get_element_data(Element* element) {
-	return element + 1;
+	return (u8*)current_frame->data.data + element->data;
+}
+
+// Moves the descendants, which have already been laid out, and their caches.
+void translate_subtree(Element* element, Pixels dx, Pixels dy) {
+	Layout* layouts = current_frame->layouts.data;
+	LayoutCache* caches = current_frame->layout_caches.data;
+	u32 end = subtree_end(element);
+	for (u32 i = element_index(element) + 1; i < end; i++) {
+		layouts[i].x += dx;
+		layouts[i].y += dy;
+		caches[i].layout.x += dx;
+		caches[i].layout.y += dy;
+	}
 }
 
-Element* push_element(usize data_size) {
-	Element* element = harena_alloc(&element_arena, sizeof(Element) + data_size);
-	if (parent) {
-		element->parent = parent;
-		parent->first_child = element;
-		element->prev_sibling = NULL;
+bool constraints_eq(Constraints a, Constraints b) {
+	return a.width == b.width && a.height == b.height && a.max_width == b.max_width && a.max_height == b.max_height;
+}
+
+// Elements using compute_layout read the parent's size as the available space.
+Size hui_legacy_measure(Element* element, Constraints constraints) {
+	Layout* layout = hui_layout(element);
+	Layout* parent_layout = hui_layout(hui_parent(element));
+	Layout saved_parent_layout = *parent_layout;
+	parent_layout->width = constraints.max_width;
+	parent_layout->height = constraints.max_height;
+	layout->width = constraints.width;
+	layout->height = constraints.height;
+	hui_compute_layout(element);
+	*parent_layout = saved_parent_layout;
+	return (Size) { .width = layout->width, .height = layout->height };
+}
+
+Size measure_finish(Element* element, Constraints constraints, Size size) {
+	LayoutCache* cache = layout_cache(element);
+	cache->valid = true;
+	cache->arranged = false;
+	cache->constraints = constraints;
+	cache->layout.width = size.width;
+	cache->layout.height = size.height;
+	Layout* layout = hui_layout(element);
+	layout->width = size.width;
+	layout->height = size.height;
+	stats.layout_calls++;
+	return size;
+}
+
+// Returns true if the size is already known. Otherwise, a frame is pushed, see hui_measure.
+bool measure_start(Element* element, Constraints constraints, Size* size) {
+	if (is_legacy(element)) {
+		*size = hui_legacy_measure(element, constraints);
+		return true;
 	}
-	else if (prev_sibling) {
-		element->prev_sibling = prev_sibling;
-		prev_sibling->next_sibling = element;
-		element->parent = prev_sibling->parent;
+	LayoutCache* cache = layout_cache(element);
+	if (cache->valid && constraints_eq(cache->constraints, constraints)) {
+		stats.layout_cache_hits++;
+		Layout* layout = hui_layout(element);
+		layout->width = cache->layout.width;
+		layout->height = cache->layout.height;
+		*size = (Size) { .width = cache->layout.width, .height = cache->layout.height };
+		return true;
+	}
+	if (has_measure_step(element)) {
+		HUIMeasureFrame* frame = stack_push(&measure_stack);
+		frame->element = element;
+		frame->constraints = constraints;
+		frame->step = 0;
+		frame->child = NULL;
+		return false;
+	}
+	*size = measure_finish(element, constraints, kind_measure(element, constraints));
+	return true;
+}
+
+// Returns the frame, which may have moved, or NULL if the child has to be measured with a frame of its own.
+// In that case, the caller must return, and it is called again with the child's size.
+HUIMeasureFrame* measure_child(HUIMeasureFrame* frame, Element* child, Constraints constraints, Size* size) {
+	HUIMeasureFrame* frames = measure_stack.data;
+	frame->child = child;
+	if (!measure_start(child, constraints, size)) {
+		return NULL;
+	}
+	// Measuring user-defined kinds may have grown the stack
+	return (HUIMeasureFrame*)measure_stack.data + (frame - frames);
+}
+
+void hui_root_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
+	(void) data;
+	Constraints constraints = frame->constraints;
+	if (frame->step == 0) {
+		Element* child = hui_first_child(frame->element);
+		if(!child || hui_next_sibling(child)) {
+			panic("Root must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, child, constraints, &child_size);
+		if (frame == NULL) return;
+	}
+	measure_done(frame, (Size) { .width = constraints.width, .height = constraints.height });
+}
+
+// Parents must use this instead of calling measure directly.
+// Only the last call is cached, so that a cache hit means that the children have
+// also been last measured with the same constraints, and their sizes can be used in arrange.
+// Built-in layouts are measured with an explicit stack. User-defined kinds measuring their
+// children call this again, which continues on top of the same stack.
+Size hui_measure(Element* element, Constraints constraints) {
+	Size size = {0};
+	usize base = measure_stack.len;
+	if (measure_start(element, constraints, &size)) {
+		return size;
+	}
+	while (measure_stack.len > base) {
+		usize len = measure_stack.len;
+		kind_measure_step((HUIMeasureFrame*)measure_stack.data + len - 1, size);
+		if (measure_stack.len == len) {
+			// No child has to be measured first, so it is done
+			HUIMeasureFrame* frame = (HUIMeasureFrame*)measure_stack.data + len - 1;
+			size = measure_finish(frame->element, frame->constraints, frame->size);
+			measure_stack.len--;
+		}
+	}
+	return size;
+}
+
+// Parents must use this instead of calling arrange directly, after measuring.
+// If neither the position nor the subtree changed since the last call, nothing is done.
+// Only the outermost call arranges. Nested calls only set the position of the child, which is
+// arranged afterwards, in the same loop over the subtree, as parents are stored before their children.
+void hui_arrange(Element* element, Pixels x, Pixels y) {
+	Layout* layout = hui_layout(element);
+	LayoutCache* cache = layout_cache(element);
+	if (is_legacy(element)) {
+		// compute_layout already positioned the children, relative to the position it had then
+		translate_subtree(element, x - layout->x, y - layout->y);
+		layout->x = x;
+		layout->y = y;
+		cache->layout.x = x;
+		cache->layout.y = y;
+		return;
+	}
+	if (cache->arranged && layout->x == x && layout->y == y) {
+		return;
+	}
+	layout->x = x;
+	layout->y = y;
+	if (element->first_child == HUI_NO_ELEMENT && element->kind < HUI_KIND_BUILTIN_COUNT) {
+		// Nothing to position
+		cache->arranged = true;
+		stats.arrange_calls++;
+		return;
+	}
+	cache->arranged = false;
+	if (arranging) {
+		return;
+	}
+
+	arranging = true;
+	LayoutCache* caches = current_frame->layout_caches.data;
+	u32 index = element_index(element);
+	u32 end = subtree_end(element);
+	while (index < end) {
+		Element* el = element_at(index);
+		if (caches[index].arranged || is_legacy(el)) {
+			// Neither it nor its subtree have to be arranged
+			index = el->first_child == HUI_NO_ELEMENT ? index + 1 : subtree_end(el);
+			continue;
+		}
+		kind_arrange(el);
+		caches[index].arranged = true;
+		stats.arrange_calls++;
+		index++;
+	}
+	arranging = false;
+}
+
+// Parents using compute_layout must use this instead of calling compute_layout directly.
+// If the inputs (the width and height set by the parent, and the parent's width and height)
+// are the same as in the last call, the last result is reused and the subtree is only translated.
+// Leaving the size computed by the last call in place also counts as the same input,
+// as parents do so when they only change the position (e.g. wrapping in a cluster).
+LayoutResult hui_compute_layout(Element* element) {
+	Layout* layout = hui_layout(element);
+	LayoutCache* cache = layout_cache(element);
+	Layout* parent_layout = hui_layout(hui_parent(element));
+	Constraints constraints = {
+		.width = layout->width,
+		.height = layout->height,
+		.max_width = parent_layout->width,
+		.max_height = parent_layout->height,
+	};
+
+	if (!is_legacy(element)) {
+		hui_measure(element, constraints);
+		hui_arrange(element, layout->x, layout->y);
+		return is_unset(layout->x) || is_unset(layout->y) ? LAYOUT_ASK_PARENT : LAYOUT_OK;
+	}
+
+	if (
+		cache->valid
+		&& cache->constraints.max_width == constraints.max_width && cache->constraints.max_height == constraints.max_height
+		&& (
+			(layout->width == cache->constraints.width && layout->height == cache->constraints.height)
+			|| (layout->width == cache->layout.width && layout->height == cache->layout.height)
+		)
+	) {
+		Pixels dx = layout->x - cache->layout.x;
+		Pixels dy = layout->y - cache->layout.y;
+		if (dx != 0 || dy != 0) {
+			translate_subtree(element, dx, dy);
+		}
+		layout->width = cache->layout.width;
+		layout->height = cache->layout.height;
+		cache->layout = *layout;
+		stats.layout_cache_hits++;
+		return cache->result;
+	}
+
+	LayoutResult result = element_kinds[element->kind].compute_layout(element, get_element_data(element));
+	*cache = (LayoutCache) {
+		.valid = true,
+		.arranged = true,
+		.result = result,
+		.constraints = constraints,
+		.layout = *layout,
+	};
+	stats.layout_calls++;
+	return result;
+}
+
+Element* push_element(u8 kind, usize data_size) {
+	assert(kind != HUI_KIND_NONE && kind < element_kinds_len);
+	u32 index = current_frame->elements.len;
+	Element element = {
+		.id = 0,
+		.parent = HUI_NO_ELEMENT,
+		.first_child = HUI_NO_ELEMENT,
+		.next_sibling = HUI_NO_ELEMENT,
+		.bounding_box = bounding_box_top(),
+		.data = current_frame->data.len,
+		.kind = kind,
+	};
+	if (parent != HUI_NO_ELEMENT) {
+		element.parent = parent;
+		element_at(parent)->first_child = index;
+	}
+	else if (prev_sibling != HUI_NO_ELEMENT) {
+		element.parent = element_at(prev_sibling)->parent;
+		element_at(prev_sibling)->next_sibling = index;
 	}
 	else {
 		panic("No parent nor prev_sibling");
 	}
-	element->layout = (Layout) { .x = UNSET, .y = UNSET, .width = UNSET, .height = UNSET };
-	element->bounding_box = bounding_box_stack[bounding_box_stack_len-1];
-	element->next_sibling = NULL;
-	element->first_child = NULL;
-	element->draw = NULL;
-	element->compute_layout = NULL;
-	element->id = 0;
-	parent = NULL;
-	prev_sibling = element;
-	return element;
+	Layout layout = { .x = UNSET, .y = UNSET, .width = UNSET, .height = UNSET };
+	LayoutCache cache = { .valid = false };
+	hvec_push(&current_frame->elements, &element);
+	hvec_push(&current_frame->layouts, &layout);
+	hvec_push(&current_frame->layout_caches, &cache);
+	hvec_extend(&current_frame->data, NULL, (data_size + 7) & ~(usize)7);
+	parent = HUI_NO_ELEMENT;
+	prev_sibling = index;
+	return element_at(index);
 }
 
-void start_bounding_box(Layout* layout) {
-	bounding_box_stack_len++;
-	assert(bounding_box_stack_len <= BOUNDING_BOX_STACK_CAP);
-	bounding_box_stack[bounding_box_stack_len-1] = layout;
+void start_bounding_box(Element* element) {
+	*(u32*)stack_push(&bounding_box_stack) = element_index(element);
 }
 
 void end_bounding_box() {
-	bounding_box_stack_len--;
+	assert(bounding_box_stack.len > 1);
+	bounding_box_stack.len--;
 }
 
 void start_adding_children() {
 	parent = prev_sibling;
-	prev_sibling = NULL;
+	prev_sibling = HUI_NO_ELEMENT;
 }
 
 void stop_adding_children() {
-	if (parent) {
+	if (parent != HUI_NO_ELEMENT) {
 		prev_sibling = parent;
-		parent = NULL;
+		parent = HUI_NO_ELEMENT;
 	}
-	else if (prev_sibling) {
-		prev_sibling = prev_sibling->parent;
-		parent = NULL;
+	else if (prev_sibling != HUI_NO_ELEMENT) {
+		prev_sibling = element_at(prev_sibling)->parent;
+		parent = HUI_NO_ELEMENT;
 	}
 }
 
-LayoutResult hui_block_layout(Element* element, void* data) {
+Size hui_block_measure(Element* element, Constraints constraints, void* data) {
+	(void) element;
+	(void) data;
+	return (Size) {
+		.width = is_unset(constraints.width) ? constraints.max_width * 0.5 : constraints.width,
+		.height = is_unset(constraints.height) ? 100 : constraints.height,
+	};
+}
+
+// For elements without children
+void hui_leaf_arrange(Element* element, void* data) {
+	(void) element;
 	(void) data;
-	LayoutResult result = LAYOUT_OK;
-	Layout* layout = &element->layout;
-	if(layout->width == UNSET) {
-		if(element->parent->layout.width == UNSET) {
-			result |= LAYOUT_ASK_PARENT;
-		}
-		else {
-			layout->width = element->parent->layout.width * 0.5;
-		}
-	}
-	if(layout->height == UNSET) {
-		layout->height = 100;
-	}
-	return result;
 }
 
 void hui_block_draw(Element* element, void* data) {
 	(void) data;
 	Color* color = get_element_data(element);
-	DrawRectangle(element->layout.x, element->layout.y, element->layout.width, element->layout.height, *color);
+	Layout* layout = hui_layout(element);
+	hui_draw_rectangle(*layout, *color);
 }
 
 void hui_block() {
-	Element* element = push_element(sizeof(Color));
-	element->draw = hui_block_draw;
-	element->compute_layout = hui_block_layout;
+	Element* element = push_element(HUI_KIND_BLOCK, sizeof(Color));
 	Color* color = get_element_data(element);
 	*color = RED;
 }
 
-LayoutResult hui_nothing_layout(Element* element, void* data) {
-	(void) data;
-	if(element->layout.width == UNSET) {
-		element->layout.width = 0;
-	}
-	if(element->layout.height == UNSET) {
-		element->layout.height = 0;
-	}
-	return LAYOUT_OK;
-}
-
-void hui_nothing_draw(Element* element, void* data) {
-	(void) data;
+Size hui_nothing_measure(Element* element, Constraints constraints, void* data) {
 	(void) element;
+	(void) data;
+	return (Size) {
+		.width = is_unset(constraints.width) ? 0 : constraints.width,
+		.height = is_unset(constraints.height) ? 0 : constraints.height,
+	};
 }
 
 void hui_nothing() {
-	Element* element = push_element(0);
-	element->draw = hui_nothing_draw;
-	element->compute_layout = hui_nothing_layout;
+	push_element(HUI_KIND_NOTHING, 0);
 }
 #endif
@@ -0,0 +1,200 @@
+#include "hui.h"
+#include "core.c"
+#include <string.h>
+
+// Zeroed, so that the commands without a texture are batched with texture 0
+HUIDrawCommand* push_draw_command(u8 kind, Rectangle rect, Color color) {
+	HUIDrawCommand* command = stack_push(&draw_commands);
+	*command = (HUIDrawCommand) { .kind = kind, .rect = rect, .color = color };
+	return command;
+}
+
+void hui_draw_rectangle(Rectangle rect, Color color) {
+	push_draw_command(HUI_DRAW_RECTANGLE, rect, color);
+}
+
+void hui_draw_rectangle_lines(Rectangle rect, Pixels thickness, Color color) {
+	push_draw_command(HUI_DRAW_RECTANGLE_LINES, rect, color)->thickness = thickness;
+}
+
+void hui_draw_texture(Texture2D texture, Rectangle source, Vector2 position, Color tint) {
+	Rectangle rect = {
+		.x = position.x,
+		.y = position.y,
+		.width = source.width < 0 ? -source.width : source.width,
+		.height = source.height < 0 ? -source.height : source.height,
+	};
+	HUIDrawCommand* command = push_draw_command(HUI_DRAW_TEXTURE, rect, tint);
+	command->source = source;
+	command->texture = texture;
+}
+
+void draw_alpha_texture(Texture2D texture, Rectangle source, Rectangle dest, Color tint, bool sdf) {
+	HUIDrawCommand* command = push_draw_command(sdf ? HUI_DRAW_SDF_TEXTURE : HUI_DRAW_ALPHA_TEXTURE, dest, tint);
+	command->source = source;
+	command->texture = texture;
+}
+
+// Scissors nest: the backend only has one, so it is set to the intersection with the outer ones,
+// and set back to the outer one at the end.
+void hui_begin_scissor(Rectangle rect) {
+	if (scissor_stack.len > 0) rect = rectangle_intersection(rect, ((Rectangle*)scissor_stack.data)[scissor_stack.len - 1]);
+	*(Rectangle*)stack_push(&scissor_stack) = rect;
+	push_draw_command(HUI_DRAW_BEGIN_SCISSOR, rect, (Color){0});
+}
+
+void hui_end_scissor() {
+	assert(scissor_stack.len > 0);
+	scissor_stack.len--;
+	if (scissor_stack.len > 0) {
+		push_draw_command(HUI_DRAW_BEGIN_SCISSOR, ((Rectangle*)scissor_stack.data)[scissor_stack.len - 1], (Color){0});
+	} else {
+		push_draw_command(HUI_DRAW_END_SCISSOR, (Rectangle){0}, (Color){0});
+	}
+}
+
+bool rectangles_overlap(Rectangle a, Rectangle b) {
+	return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// How many batches back a command can be moved to join one with the same texture
+#define HUI_DRAW_BATCH_LOOKBACK 16
+// The screen is split in cells of this size, which remember the last batch drawn over them
+#define HUI_DRAW_GRID_CELL 16
+
+typedef struct {
+	usize x0, y0, x1, y1; // Inclusive
+} HUIDrawCells;
+
+usize grid_columns = 0;
+usize grid_rows = 0;
+
+usize grid_clamp(Pixels position, usize count) {
+	if (position < 0) return 0;
+	usize cell = position / HUI_DRAW_GRID_CELL;
+	return cell < count ? cell : count - 1;
+}
+
+// The parts outside of the screen are in the cells of the border, which is conservative
+HUIDrawCells grid_cells(Rectangle rect) {
+	return (HUIDrawCells) {
+		.x0 = grid_clamp(rect.x, grid_columns),
+		.y0 = grid_clamp(rect.y, grid_rows),
+		.x1 = grid_clamp(rect.x + rect.width, grid_columns),
+		.y1 = grid_clamp(rect.y + rect.height, grid_rows),
+	};
+}
+
+// Switching textures ends the backend's batch (in raylib, a draw call), so commands are grouped
+// by texture. A command joins the last batch with its texture, unless something drawn after that
+// batch overlaps it, as then it would be drawn below it. Overlaps are tracked with a coarse grid
+// over the screen, so nearby commands are conservatively treated as overlapping.
+// Scissor changes also end the batch, so commands are never moved across them.
+void draw_flush() {
+	usize len = draw_commands.len;
+	if (len == 0) return;
+	HUIDrawCommand* commands = draw_commands.data;
+	Layout* screen = hui_layout(element_at(0));
+	grid_columns = screen->width / HUI_DRAW_GRID_CELL + 1;
+	grid_rows = screen->height / HUI_DRAW_GRID_CELL + 1;
+	hvec_clear(&draw_grid);
+	u32* grid = hvec_extend(&draw_grid, NULL, grid_columns*grid_rows); // The last batch over each cell, plus one
+	memset(grid, 0, grid_columns*grid_rows*sizeof(u32));
+	u32* batch_of = hvec_extend(&draw_order, NULL, 2*len);
+	u32* order = batch_of + len;
+	hvec_clear(&draw_batches);
+	usize first_batch = 0; // Commands can not be moved before it
+	for (usize i = 0; i < len; i++) {
+		HUIDrawCommand* command = &commands[i];
+		HUIDrawBatch* batches = draw_batches.data;
+		usize batch = draw_batches.len;
+		if (command->kind == HUI_DRAW_BEGIN_SCISSOR || command->kind == HUI_DRAW_END_SCISSOR) {
+			first_batch = batch + 1;
+		} else if (!rectangles_overlap(command->rect, *screen)) {
+			// It can go in any batch, as it does not draw anything
+			usize lowest = batch > first_batch + HUI_DRAW_BATCH_LOOKBACK ? batch - HUI_DRAW_BATCH_LOOKBACK : first_batch;
+			for (usize b = draw_batches.len; b > lowest; b--) {
+				if (batches[b-1].texture == command->texture.id) {
+					batch = b-1;
+					break;
+				}
+			}
+		} else {
+			HUIDrawCells cells = grid_cells(command->rect);
+			usize lowest = batch > first_batch + HUI_DRAW_BATCH_LOOKBACK ? batch - HUI_DRAW_BATCH_LOOKBACK : first_batch;
+			for (usize y = cells.y0; y <= cells.y1; y++) {
+				for (usize x = cells.x0; x <= cells.x1; x++) {
+					// It can still join the batch that overlaps it, after the command it overlaps
+					if (grid[y*grid_columns + x] > lowest + 1) lowest = grid[y*grid_columns + x] - 1;
+				}
+			}
+			for (usize b = draw_batches.len; b > lowest; b--) {
+				if (batches[b-1].texture == command->texture.id) {
+					batch = b-1;
+					break;
+				}
+			}
+			for (usize y = cells.y0; y <= cells.y1; y++) {
+				for (usize x = cells.x0; x <= cells.x1; x++) {
+					grid[y*grid_columns + x] = batch + 1;
+				}
+			}
+		}
+		if (batch == draw_batches.len) {
+			HUIDrawBatch* new_batch = stack_push(&draw_batches);
+			new_batch->texture = command->texture.id;
+			new_batch->start = 0;
+		}
+		batch_of[i] = batch;
+		((HUIDrawBatch*)draw_batches.data)[batch].start++;
+	}
+
+	// Counting sort by batch, which keeps the order inside of each batch
+	HUIDrawBatch* batches = draw_batches.data;
+	u32 start = 0;
+	for (usize b = 0; b < draw_batches.len; b++) {
+		u32 count = batches[b].start;
+		batches[b].start = start;
+		start += count;
+	}
+	for (usize i = 0; i < len; i++) {
+		order[batches[batch_of[i]].start++] = i;
+	}
+
+	HUIShader shader = HUI_SHADER_NONE; // Commands of the same texture are together, so it rarely changes
+	for (usize i = 0; i < len; i++) {
+		HUIDrawCommand* command = &commands[order[i]];
+		HUIShader command_shader = command->kind == HUI_DRAW_ALPHA_TEXTURE ? HUI_SHADER_ALPHA
+			: command->kind == HUI_DRAW_SDF_TEXTURE ? HUI_SHADER_SDF
+			: HUI_SHADER_NONE;
+		if (command_shader != shader) {
+			shader = command_shader;
+			backend.set_shader(shader);
+		}
+		switch (command->kind) {
+			case HUI_DRAW_RECTANGLE:
+				backend.draw_rectangle(command->rect, command->color);
+				break;
+			case HUI_DRAW_RECTANGLE_LINES:
+				backend.draw_rectangle_lines(command->rect, command->thickness, command->color);
+				break;
+			case HUI_DRAW_TEXTURE:
+			case HUI_DRAW_ALPHA_TEXTURE:
+			case HUI_DRAW_SDF_TEXTURE:
+				backend.draw_texture(command->texture, command->source, command->rect, command->color);
+				break;
+			case HUI_DRAW_BEGIN_SCISSOR:
+				backend.begin_scissor(command->rect);
+				break;
+			case HUI_DRAW_END_SCISSOR:
+				backend.end_scissor();
+				break;
+		}
+	}
+	if (shader != HUI_SHADER_NONE) backend.set_shader(HUI_SHADER_NONE);
+
+	stats.draw_commands += len;
+	stats.draw_batches += draw_batches.len;
+	hvec_clear(&draw_commands);
+	hvec_clear(&draw_order);
+}
@@ -3,6 +3,7 @@
 
 #include "../hlib/core.h"
 #include "../hlib/hstring.h"
+#include "../hlib/hvec.h"
 #include <raylib.h>
 
 typedef f32 Pixels;
@@ -18,35 +19,194 @@ static const LayoutResult LAYOUT_ASK_PARENT = 1;
 static const LayoutResult LAYOUT_ASK_CHILDREN = 2;
 static const LayoutResult LAYOUT_ASK_ALL = LAYOUT_ASK_PARENT | LAYOUT_ASK_CHILDREN;
 
+typedef struct {
+	Pixels width;  // Exact width, or UNSET to use the intrinsic one
+	Pixels height;
+	Pixels max_width; // Available space, for when the width is UNSET
+	Pixels max_height;
+} Constraints;
+
+typedef struct {
+	Pixels width;
+	Pixels height;
+} Size;
+
+// The inputs and output of the last measure (or compute_layout) call, see hui_measure.
+typedef struct {
+	bool         valid;
+	bool         arranged; // The subtree has been positioned since the last measure
+	LayoutResult result; // Only used by compute_layout
+	Constraints  constraints;
+	Layout       layout;
+} LayoutCache;
+
+#define HUI_NO_ELEMENT ((u32)-1)
+
+// Elements are stored contiguously, and refer to each other by index.
+// Their layouts and layout caches are stored in parallel arrays, and their data in a
+// separate buffer, so use the accessors below (hui_layout, hui_parent...).
+// Pointers to elements, and their data, are only valid until the next push_element.
 typedef struct Element {
-	ElementId       id;
-	struct Element* parent;
-	struct Element* first_child;
-	struct Element* next_sibling;
-	struct Element* prev_sibling;
-	Layout          layout;
-	Layout*         bounding_box;
-	LayoutResult    (*compute_layout)(struct Element*, void*);
-	void            (*draw)(struct Element*, void*);
+	ElementId id;
+	u32       parent;
+	u32       first_child;
+	u32       next_sibling;
+	u32       bounding_box; // Index of the element whose layout is the bounding box
+	u32       data; // Offset into the data buffer
+	u8        kind;
 } Element;
 
+// Measure returns the size given the constraints, measuring the children as needed.
+// Arrange positions the children, once the element's layout is known.
+// If measure is NULL, compute_layout is used instead (see DESIGN.md).
+typedef struct {
+	Size         (*measure)(Element*, Constraints, void*);
+	void         (*arrange)(Element*, void*);
+	LayoutResult (*compute_layout)(Element*, void*);
+	void         (*draw)(Element*, void*);
+} ElementKind;
+
+typedef struct {
+	f64   layout_ms;
+	f64   handle_ms;
+	f64   draw_ms;
+	usize layout_calls; // measure and compute_layout functions actually called
+	usize layout_cache_hits;
+	usize arrange_calls;
+	usize handlers_skipped; // As their element could not be seen
+	usize elements_built;
+	usize elements_drawn; // The others could not be seen
+	usize draw_commands;
+	usize draw_batches; // Roughly the draw calls, see draw_flush
+	usize texture_loads; // GPU allocations, only when the glyph atlas is created
+	usize glyphs_rasterized; // Put in the glyph atlas
+	usize glyphs_pending; // Not drawn, as the workers are still rasterizing them, see hui_set_glyph_threads
+} HUIStats;
+
+// The input of a frame, taken once before the handlers run.
+typedef enum {
+	HUI_KEY_BACKSPACE = 1 << 0, // Pressed this frame, or repeating
+	HUI_KEY_LEFT      = 1 << 1,
+	HUI_KEY_RIGHT     = 1 << 2,
+} HUIKey;
+
+typedef struct {
+	Vector2 mouse;
+	Vector2 wheel;
+	bool    mouse_pressed; // Left button, this frame
+	bool    mouse_released;
+	u32     keys; // HUIKey
+	int     key_pressed; // Raylib key code, 0 if none
+	int     char_pressed; // Unicode codepoint, 0 if none
+	f32     frame_time; // Seconds
+} HUIInput;
+
+typedef struct {
+	Image   image; // RGBA, white with the coverage in the alpha
+	Vector2 offset; // From the pen position to the top left corner
+} HUIGlyphImage;
+
+// How the textures drawn are shaded. The alpha ones only have one channel (R8), which is the alpha
+// of the tint: the coverage, or a signed distance field (0.5 on the edge) that is thresholded.
+typedef enum {
+	HUI_SHADER_NONE,
+	HUI_SHADER_ALPHA,
+	HUI_SHADER_SDF,
+} HUIShader;
+
+// Everything hui needs from the platform. The raylib one is used unless another one is set
+// with hui_set_backend before hui_init. The null one does not need a window, so frames can
+// be built, laid out and drawn (to nowhere) in tests and benchmarks.
+typedef struct {
+	Size   (*screen_size)(void);
+	void   (*input)(HUIInput*);
+	// Text. A zeroed Font is the backend's default one.
+	Font   (*load_font)(const char* path, int size);
+	void   (*unload_font)(Font font);
+	Pixels (*glyph_advance)(Font font, int codepoint, Pixels font_size);
+	// On the CPU. Both are called from the glyph worker threads, see hui_set_glyph_threads.
+	HUIGlyphImage (*rasterize_glyph)(Font font, int codepoint, Pixels font_size);
+	void   (*unload_image)(Image image);
+	// Textures
+	Texture2D (*load_alpha_texture)(int width, int height, bool smooth); // R8, zeroed, smooth is filtered bilinearly
+	void   (*unload_texture)(Texture2D texture);
+	void   (*update_texture)(Texture2D texture, Rectangle rect, Image image); // In the format of the texture
+	// Drawing
+	void   (*draw_rectangle)(Rectangle rect, Color color);
+	void   (*draw_rectangle_lines)(Rectangle rect, Pixels thickness, Color color);
+	void   (*draw_texture)(Texture2D texture, Rectangle source, Rectangle dest, Color tint);
+	void   (*set_shader)(HUIShader shader); // For what is drawn after, HUI_SHADER_NONE when the frame starts
+	void   (*begin_scissor)(Rectangle rect);
+	void   (*end_scissor)(void);
+	// Idle mode, see hui_wait
+	f64    (*time)(void); // Seconds
+	bool   (*wait_events)(f64 timeout); // Seconds, negative for none. True if the window changed (resized, closed...)
+} HUIBackend;
+
+HUIBackend hui_raylib_backend();
+HUIBackend hui_null_backend(Pixels width, Pixels height);
+void hui_set_backend(HUIBackend backend);
+HUIInput hui_get_input(); // Of the current frame
+
 i64 hui_get_frame_num();
+// Idle mode: calling hui_wait before each frame blocks until one has to be drawn, instead of
+// drawing the same frame over and over
+void hui_wait();
+void hui_request_redraw(); // For changes hui can not see, like data arriving from elsewhere
+void hui_request_redraw_in(f64 seconds); // For animations
+f64 hui_get_time(); // Seconds, of the backend
+HUIStats hui_get_stats(); // Of the last frame. Also printed every frame when built with HUI_PRINT_STATS (make stats=1)
 Element* current_element();
 bool is_unset(Pixels value);
+Pixels constraints_width(Constraints constraints);
+Pixels constraints_height(Constraints constraints);
 void push_handler(void (*handler)(Element*, void*), Element* el);
+void push_hover_handler(void (*handler)(Element*, void*), Element* el);
 void hui_init();
 void hui_deinit();
 void hui_root_start();
 void hui_root_end();
+u8 hui_register_element_kind(ElementKind kind);
 void* get_element_data(Element* element);
-Element* push_element(usize data_size);
-void start_bounding_box(Layout* layout);
+Layout* hui_layout(Element* element);
+Layout* hui_bounding_box(Element* element);
+bool hui_hovered(Element* element); // Under the mouse, and not below another interactive element
+Element* hui_parent(Element* element); // These return NULL if there is none
+Element* hui_first_child(Element* element);
+Element* hui_next_sibling(Element* element);
+Size hui_measure(Element* element, Constraints constraints);
+void hui_arrange(Element* element, Pixels x, Pixels y);
+LayoutResult hui_compute_layout(Element* element);
+void translate_subtree(Element* element, Pixels dx, Pixels dy);
+void hui_draw(Element* element);
+// For the draw functions of elements. The commands are recorded, and drawn at the end of the
+// draw pass grouped by texture, keeping the order of the ones that overlap.
+// Drawing through raylib directly also works, but is not batched.
+void hui_draw_rectangle(Rectangle rect, Color color);
+void hui_draw_rectangle_lines(Rectangle rect, Pixels thickness, Color color);
+void hui_draw_texture(Texture2D texture, Rectangle source, Vector2 position, Color tint);
+void hui_begin_scissor(Rectangle rect);
+void hui_end_scissor();
+Element* push_element(u8 kind, usize data_size);
+void start_bounding_box(Element* element);
 void end_bounding_box();
 void start_adding_children();
 void stop_adding_children();
 void hui_nothing();
 void hui_block();
 
+// Memoization: if an element with the same id and hash was built in the previous frame,
+// its subtree is reused (and its layout too, if the constraints did not change), and this returns false.
+// Otherwise it returns true, and the (exactly one) child must be built as usual.
+// The hash must cover everything the subtree depends on, including scroll offsets and hot/active ids.
+//
+//	if (hui_memo_start(id, hash)) {
+//		...
+//	}
+//	hui_memo_end();
+bool hui_memo_start(ElementId id, u64 hash);
+void hui_memo_end();
+
 // Layouts
 void hui_stack_start(Pixels gap);
 void hui_stack_end();
@@ -83,9 +243,38 @@ void hui_fixed_end();
 void hui_scroll_start(Pixels* offset);
 void hui_scroll_end();
 
+// The state of a hui_virtual_list, kept by the caller between frames. Zeroed, it is at the top.
+// The position is an item and an offset into it, so it does not move when the items above change height.
+typedef struct {
+	usize  first; // The item at the top
+	Pixels first_offset; // How much of it is scrolled past
+	Pixels height; // Of the list, in the last frame
+	usize  built_first; // The items built in the last frame, and their heights
+	HVec   built_heights; // Pixels
+} HUIVirtualList;
+
+// A vertical list of count items, scrolled with the wheel, which takes all of the height available.
+// Only the items in view (and a few around them) are built, by calling build with their index, which
+// must build exactly one element. The items not built in the last frame are estimated_height high.
+void hui_virtual_list(HUIVirtualList* list, usize count, Pixels estimated_height, Pixels gap, void (*build)(usize index, void* user), void* user);
+void hui_virtual_list_free(HUIVirtualList* list);
+
+// 0 is the default font of the backend
+typedef u32 HUIFont;
+
+// Each path and size is only loaded once, and the font is kept until hui_deinit. Call after hui_init.
+HUIFont hui_load_font(const char* path, int size);
+// Glyphs are rasterized once as distance fields and scaled to every font size, instead of rasterized
+// for each font size. Softer at small sizes, but changing the font size costs no rasterization.
+void hui_set_sdf_text(bool enabled);
+// Glyphs are rasterized on this many threads (2 by default), and only drawn once ready, so new text
+// does not make frames longer. 0 rasterizes them when drawn, on the calling thread.
+void hui_set_glyph_threads(usize count);
+
 typedef struct {
 	Color color;
 	Pixels font_size;
+	HUIFont font;
 } TextStyle;
 
 void hui_text(str text, TextStyle style);
@@ -95,6 +284,20 @@ void hui_cursor_text(str text, TextStyle style, usize cursor);
 bool hui_button(ElementId id, str text, TextStyle style);
 u64 hui_text_input(strb* builder, usize* cursor, TextStyle style);
 
-usize hui_get_text_cache_used();
-usize hui_get_text_cache_cap();
+// The layouts of text are cached, until they take more than the budget (8 MiB by default),
+// then the least recently used ones are evicted.
+typedef struct {
+	usize hits;
+	usize misses;
+	usize evictions;
+	usize entries;
+	usize bytes;
+	usize budget;
+	usize atlas_bytes; // On the GPU, for the glyphs of all text
+	usize atlas_bytes_saved; // As the atlases only store the alpha, compared to RGBA
+} HUITextCacheStats;
+
+usize hui_get_text_cache_used(); // Entries
+HUITextCacheStats hui_get_text_cache_stats(); // Since hui_init
+void hui_set_text_cache_budget(usize bytes);
 #endif
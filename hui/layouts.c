@@ -1,40 +1,58 @@
 #include "hui.h"
 #include "core.c"
 
-LayoutResult hui_stack_layout(Element* el, void* data) {
+void hui_stack_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
 	Pixels gap = *(Pixels*)data;
-	LayoutResult result = LAYOUT_OK;
+	Constraints constraints = frame->constraints;
+	Pixels width = constraints_width(constraints);
+	assert(!is_unset(width));
+	Constraints child_constraints = {
+		.width = width,
+		.height = UNSET,
+		.max_width = width,
+		.max_height = constraints_height(constraints),
+	};
 
-	if (is_unset(el->layout.width)) {
-		el->layout.width = el->parent->layout.width;
-		assert(!is_unset(el->layout.width));
+	Element* child;
+	Pixels height;
+	if (frame->step == 0) {
+		frame->step = 1;
+		height = 0;
+		child = hui_first_child(frame->element);
+	} else {
+		height = frame->state.height + child_size.height + gap;
+		child = hui_next_sibling(frame->child);
+	}
+	for (; child != NULL; child = hui_next_sibling(child)) {
+		frame->state.height = height;
+		frame = measure_child(frame, child, child_constraints, &child_size);
+		if (frame == NULL) return;
+		height += child_size.height + gap;
 	}
 
-	Pixels y = el->layout.y;
-	Pixels x = el->layout.x;
-
-	Element* child = el->first_child;
-	while(child != NULL) {
-		child->layout.width = el->layout.width;
-		child->layout.y = y;
-		child->layout.x = x;
+	if (hui_first_child(frame->element) != NULL) {
+		height -= gap;
+	}
+	measure_done(frame, (Size) {
+		.width = width,
+		.height = is_unset(constraints.height) ? height : constraints.height,
+	});
+}
 
-		child->compute_layout(child, child+1);
-		y += child->layout.height + gap;
+void hui_stack_arrange(Element* el, void* data) {
+	Pixels gap = *(Pixels*)data;
+	Pixels y = hui_layout(el)->y;
 
-		child = child->next_sibling;
-	}
-	if (is_unset(el->layout.height)) {
-		el->layout.height = y - el->layout.y - gap;
+	Element* child = hui_first_child(el);
+	while(child != NULL) {
+		hui_arrange(child, hui_layout(el)->x, y);
+		y += hui_layout(child)->height + gap;
+		child = hui_next_sibling(child);
 	}
-
-	return result;
 }
 
 void hui_stack_start(Pixels gap) {
-	Element* element = push_element(sizeof(Pixels));
-	element->compute_layout = hui_stack_layout;
-	element->draw = hui_root_draw;
+	Element* element = push_element(HUI_KIND_STACK, sizeof(Pixels));
 	*(Pixels*)get_element_data(element) = gap;
 	start_adding_children();
 }
@@ -51,74 +69,58 @@ Margin margin_add(Margin a, Margin b) {
 void hui_stack_end() {
 	stop_adding_children();
 }
-LayoutResult hui_box_layout(Element* el, void* data) {
+void hui_box_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
 	BoxStyle style = *(BoxStyle*)data;
-	LayoutResult result = LAYOUT_OK;
-	Layout* layout = &el->layout;
+	Constraints constraints = frame->constraints;
 	Margin total_padding = margin_add(style.padding, style.border);
 	Pixels total_horizontal_padding = total_padding.left + total_padding.right;
 	Pixels total_vertical_padding = total_padding.top + total_padding.bottom;
 
-	if (el->first_child == NULL || el->first_child->next_sibling != NULL) {
-		panic("Box must have exactly one child");
-	}
-
-	bool width_was_set_by_parent = !is_unset(layout->width);
-	bool height_was_set_by_parent = !is_unset(layout->height);
-
-	if (width_was_set_by_parent) {
-		el->first_child->layout.width = layout->width - total_horizontal_padding;
-	} else {
-		layout->width = el->parent->layout.width - total_horizontal_padding; // Temporary, until children's width is computed
-	}
-	if (height_was_set_by_parent) {
-		el->first_child->layout.height = layout->height - total_vertical_padding;
-	} else {
-		layout->height = el->parent->layout.height - total_vertical_padding; // Temporary, until children's height is computed
-	}
-
-	if (!is_unset(layout->x)) {
-		el->first_child->layout.x = layout->x + total_padding.left;
-	} else {
-		result |= LAYOUT_ASK_PARENT;
-	}
-	if (!is_unset(layout->y)) {
-		el->first_child->layout.y = layout->y + total_padding.top;
-	} else {
-		result |= LAYOUT_ASK_PARENT;
-	}
-
-	el->first_child->compute_layout(el->first_child, el->first_child+1);
+	bool width_was_set_by_parent = !is_unset(constraints.width);
+	bool height_was_set_by_parent = !is_unset(constraints.height);
 
-	if (!width_was_set_by_parent) {
-		layout->width = el->first_child->layout.width + total_horizontal_padding;
-	}
-	if (!height_was_set_by_parent) {
-		layout->height = el->first_child->layout.height + total_vertical_padding;
-	}
+	if (frame->step == 0) {
+		Element* el = frame->element;
+		if (hui_first_child(el) == NULL || hui_next_sibling(hui_first_child(el)) != NULL) {
+			panic("Box must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, hui_first_child(el), (Constraints) {
+			.width = width_was_set_by_parent ? constraints.width - total_horizontal_padding : UNSET,
+			.height = height_was_set_by_parent ? constraints.height - total_vertical_padding : UNSET,
+			.max_width = constraints_width(constraints) - total_horizontal_padding,
+			.max_height = constraints_height(constraints) - total_vertical_padding,
+		}, &child_size);
+		if (frame == NULL) return;
+	}
+
+	measure_done(frame, (Size) {
+		.width = width_was_set_by_parent ? constraints.width : child_size.width + total_horizontal_padding,
+		.height = height_was_set_by_parent ? constraints.height : child_size.height + total_vertical_padding,
+	});
+}
 
-	return result;
+void hui_box_arrange(Element* el, void* data) {
+	BoxStyle style = *(BoxStyle*)data;
+	Margin total_padding = margin_add(style.padding, style.border);
+	hui_arrange(hui_first_child(el), hui_layout(el)->x + total_padding.left, hui_layout(el)->y + total_padding.top);
 }
 
 void hui_box_draw(Element* el, void* data) {
 	BoxStyle style = *(BoxStyle*)data;
-	Layout* layout = &el->layout;
-	assert(el->first_child);
+	Layout* layout = hui_layout(el);
 
 	if (style.background_color.a != 0) {
-		DrawRectangle(layout->x, layout->y, layout->width, layout->height, style.background_color);
+		hui_draw_rectangle(*layout, style.background_color);
 	}
 	if (style.border_color.a != 0) {
 		// TODO: Handle different borders correctly
-		DrawRectangleLinesEx((Rectangle){.x = layout->x, .y = layout->y, .width = layout->width, .height = layout->height}, style.border.top, style.border_color);
+		hui_draw_rectangle_lines(*layout, style.border.top, style.border_color);
 	}
-	el->first_child->draw(el->first_child, el->first_child+1);
 }
 
 void hui_box_start(BoxStyle style) {
-	Element* element = push_element(sizeof(BoxStyle));
-	element->compute_layout = hui_box_layout;
-	element->draw = hui_box_draw;
+	Element* element = push_element(HUI_KIND_BOX, sizeof(BoxStyle));
 	*(BoxStyle*)get_element_data(element) = style;
 	start_adding_children();
 }
@@ -127,57 +129,42 @@ void hui_box_end() {
 	stop_adding_children();
 }
 
-LayoutResult hui_center_layout(Element* el, void* data) {
-	Layout* layout = &el->layout;
+void hui_center_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
 	Pixels padding = *(Pixels*)data;
-	if (el->first_child == NULL || el->first_child->next_sibling != NULL) {
-		panic("Box must have exactly one child");
-	}
-
-	bool width_was_set_by_parent = !is_unset(layout->width);
-	bool height_was_set_by_parent = !is_unset(layout->height);
-	Pixels padded_width;
-
-	if (width_was_set_by_parent) {
-		padded_width = layout->width;
-	} else {
-		padded_width = el->parent->layout.width;
-	}
-	layout->width = padded_width - 2*padding; // Remove padding, for children to use
-
-	if (!height_was_set_by_parent) {
-		layout->height = el->parent->layout.height; // Temporary, until children's height is computed
-	}
-
-	el->first_child->layout.y = layout->y;
-	LayoutResult child_layout_result = el->first_child->compute_layout(el->first_child, el->first_child+1);
+	Constraints constraints = frame->constraints;
+	Pixels padded_width = constraints_width(constraints);
 
-	layout->width = padded_width;
-
-	if (!height_was_set_by_parent) {
-		layout->height = el->first_child->layout.height;
-	}
-
-	el->first_child->layout.x = layout->x + (padded_width - el->first_child->layout.width)/2;
-
-	if (child_layout_result & LAYOUT_ASK_PARENT) {
-		el->first_child->compute_layout(el->first_child, el->first_child+1);
-	}
-
-	return LAYOUT_OK;
+	if (frame->step == 0) {
+		Element* el = frame->element;
+		if (hui_first_child(el) == NULL || hui_next_sibling(hui_first_child(el)) != NULL) {
+			panic("Box must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, hui_first_child(el), (Constraints) {
+			.width = UNSET,
+			.height = UNSET,
+			.max_width = padded_width - 2*padding,
+			.max_height = constraints_height(constraints),
+		}, &child_size);
+		if (frame == NULL) return;
+	}
+
+	measure_done(frame, (Size) {
+		.width = padded_width,
+		.height = is_unset(constraints.height) ? child_size.height : constraints.height,
+	});
 }
 
-void hui_center_draw(Element* el, void* data) {
+void hui_center_arrange(Element* el, void* data) {
 	(void) data;
-	assert(el->first_child && !el->first_child->next_sibling);
-	el->first_child->draw(el->first_child, el->first_child+1);
+	Layout* layout = hui_layout(el);
+	Element* child = hui_first_child(el);
+	hui_arrange(child, layout->x + (layout->width - hui_layout(child)->width)/2, layout->y);
 }
 
 // Padding is only horizontal
 void hui_center_start(Pixels padding) {
-	Element* element = push_element(sizeof(Pixels));
-	element->compute_layout = hui_center_layout;
-	element->draw = hui_center_draw;;
+	Element* element = push_element(HUI_KIND_CENTER, sizeof(Pixels));
 	*(Pixels*)get_element_data(element) = padding;
 	start_adding_children();
 }
@@ -186,106 +173,113 @@ void hui_center_end() {
 	stop_adding_children();
 }
 
-LayoutResult hui_cluster_layout(Element* el, void* data) {
-	// How it should work:
-	// - If width not set, simply put all the children in a row
-	// - If width is set, then for each child
-	//   - First, try intrinsic sizing
-	//   - If it would go over the width adding it after the other elements in its row, then put it next row
-	//   - If its size is bigger than the width, then set the child's width to the cluster width and relayout
-	// - Keep track of the biggest height of every row, and add it + padding after every row
-	// - Padding is only inside the cluster. There should be no padding between the top left element and the parent
-	Layout* layout = &el->layout;
+// How it works:
+// - Each child is first measured with its intrinsic size
+// - If it would go over the width adding it after the other elements in its row, then it is put in the next row
+// - If its size is bigger than the width, then its width is set to the cluster width and it is measured again
+// - Keep track of the biggest height of every row, and add it + padding after every row
+// - Padding is only inside the cluster. There should be no padding between the top left element and the parent
+// The rows are computed again in arrange, with the final sizes of the children, which gives the same result.
+void hui_cluster_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
 	Pixels padding = *(Pixels*)data;
-	LayoutResult result = LAYOUT_OK;
-	bool width_was_set_by_parent = !is_unset(layout->width);
-	bool height_was_set_by_parent = !is_unset(layout->height);
-
-	Pixels row_max_height = 0;
-	Pixels max_width = 0;
-	Pixels x = layout->x;
-	Pixels y = layout->y;
-
-	Pixels width_limit;
-	if (width_was_set_by_parent) {
-		width_limit = layout->width;
+	Constraints constraints = frame->constraints;
+	Pixels width_limit = constraints_width(constraints);
+	Constraints intrinsic = {
+		.width = UNSET,
+		.height = UNSET,
+		.max_width = width_limit,
+		.max_height = constraints_height(constraints),
+	};
+	Constraints clamped = intrinsic;
+	clamped.width = width_limit;
+
+	// Steps: 1 means that the child has to be measured, 2 that child_size is its intrinsic size,
+	// and 3 that it is its size clamped to the width
+	Element* child;
+	if (frame->step == 0) {
+		frame->step = 1;
+		frame->state.cluster.row_max_height = 0;
+		frame->state.cluster.max_width = 0;
+		frame->state.cluster.x = 0;
+		frame->state.cluster.y = 0;
+		frame->state.cluster.row_empty = true;
+		child = hui_first_child(frame->element);
 	} else {
-		width_limit = el->parent->layout.width;
-		layout->width = el->parent->layout.width; // Temporary, for the children
-	}
-	if (!height_was_set_by_parent) {
-		layout->height = el->parent->layout.height; // Temporary, for the children
+		child = frame->child;
 	}
+	for (; child != NULL; child = hui_next_sibling(child)) {
+		if (frame->step == 1) {
+			frame->step = 2;
+			frame = measure_child(frame, child, intrinsic, &child_size);
+			if (frame == NULL) return;
+		}
+		if (frame->step == 2 && child_size.width > width_limit) {
+			frame->step = 3;
+			frame = measure_child(frame, child, clamped, &child_size);
+			if (frame == NULL) return;
+		}
+		frame->step = 1;
 
-	Element* child = el->first_child;
-	while(child != NULL) {
-		child->layout.x = x;
-		child->layout.y = y;
-		child->compute_layout(child, child+1);
-
-		if (x + child->layout.width > layout->x + width_limit) {
+		if (!frame->state.cluster.row_empty && frame->state.cluster.x + child_size.width > width_limit) {
 			// Advance a row
-			if (x - padding - layout->x > max_width) {
-				max_width = x - padding - layout->x;
-			}
-			y += row_max_height + padding;
-			x = layout->x;
-
-			child->layout.y = y;
-			child->layout.x = x;
-			row_max_height = 0;
-
-			if (child->layout.width > width_limit) {
-				child->layout.width = width_limit;
-				child->layout.height = UNSET;
+			if (frame->state.cluster.x - padding > frame->state.cluster.max_width) {
+				frame->state.cluster.max_width = frame->state.cluster.x - padding;
 			}
-			child->compute_layout(child, child+1);
+			frame->state.cluster.y += frame->state.cluster.row_max_height + padding;
+			frame->state.cluster.x = 0;
+			frame->state.cluster.row_max_height = 0;
 		}
 
-		if (child->layout.height > row_max_height) {
-			row_max_height = child->layout.height;
+		if (child_size.height > frame->state.cluster.row_max_height) {
+			frame->state.cluster.row_max_height = child_size.height;
 		}
-		x += child->layout.width + padding;
-
-		child = child->next_sibling;
+		frame->state.cluster.x += child_size.width + padding;
+		frame->state.cluster.row_empty = false;
 	}
 
-	if(!height_was_set_by_parent) {
-		layout->height = y + row_max_height - layout->y;
-	} else {
-		if(y + row_max_height - layout->y > layout->height) {
-			// Oopsie daisy, too large. TODO: Handle this somehow
-		}
-	}
-	if(!width_was_set_by_parent) {
-		if (x - padding - layout->x > max_width) {
-			max_width = x - padding - layout->x;
-		}
-		layout->width = max_width;
+	Pixels max_width = frame->state.cluster.max_width;
+	if (frame->state.cluster.x - padding > max_width) {
+		max_width = frame->state.cluster.x - padding;
 	}
 
-	if (!layout->x) {
-		result |= LAYOUT_ASK_PARENT;
-	}
-	if (!layout->y) {
-		result |= LAYOUT_ASK_PARENT;
-	}
-	return result;
+	// If the height was set by the parent, the children may not fit. TODO: Handle this somehow
+	measure_done(frame, (Size) {
+		.width = is_unset(constraints.width) ? max_width : constraints.width,
+		.height = is_unset(constraints.height) ? frame->state.cluster.y + frame->state.cluster.row_max_height : constraints.height,
+	});
 }
 
-void hui_cluster_draw(Element* el, void* data) {
-	(void) data;
-	Element* child = el->first_child;
+void hui_cluster_arrange(Element* el, void* data) {
+	Pixels padding = *(Pixels*)data;
+	Layout* layout = hui_layout(el);
+	Pixels width_limit = layout->width;
+
+	Pixels row_max_height = 0;
+	Pixels x = 0;
+	Pixels y = 0;
+	bool row_empty = true;
+
+	Element* child = hui_first_child(el);
 	while(child != NULL) {
-		child->draw(child, child+1);
-		child = child->next_sibling;
+		if (!row_empty && x + hui_layout(child)->width > width_limit) {
+			y += row_max_height + padding;
+			x = 0;
+			row_max_height = 0;
+		}
+		hui_arrange(child, layout->x + x, layout->y + y);
+
+		if (hui_layout(child)->height > row_max_height) {
+			row_max_height = hui_layout(child)->height;
+		}
+		x += hui_layout(child)->width + padding;
+		row_empty = false;
+
+		child = hui_next_sibling(child);
 	}
 }
 
 void hui_cluster_start(Pixels padding) {
-	Element* element = push_element(sizeof(Pixels));
-	element->compute_layout = hui_cluster_layout;
-	element->draw = hui_cluster_draw;
+	Element* element = push_element(HUI_KIND_CLUSTER, sizeof(Pixels));
 	*(Pixels*)get_element_data(element) = padding;
 	start_adding_children();
 }
@@ -294,83 +288,83 @@ void hui_cluster_end() {
 	stop_adding_children();
 }
 
-LayoutResult hui_leftright_layout(Element* el, void* data) {
-	Layout* layout = &el->layout;
-	Pixels padding = *(Pixels*)data;
-	LayoutResult result = LAYOUT_OK;
-
-	if(!el->first_child || !el->first_child->next_sibling || el->first_child->next_sibling->next_sibling) {
-		panic("Leftright must have exactly two children.");
-	}
-	Element* left = el->first_child;
-	Element* right = left->next_sibling;
-
-	if (is_unset(layout->width)) {
-		layout->width = el->parent->layout.width;
-	}
-
-	Pixels x = layout->x;
-	Pixels y = layout->y;
-
-	left->layout.x = x;
-	left->layout.y = y;
-	left->compute_layout(left, left+1);
-	x += left->layout.width + padding;
-
-	if (left->layout.width > layout->width) {
-		left->layout.width = layout->width;
-		left->layout.height = UNSET;
-		left->compute_layout(left, left+1);
-	}
-
-	bool wrapped;
+typedef struct {
+	Pixels padding;
+	bool   wrapped; // The right element is below the left one
+} HUILeftRightData;
+
+void hui_leftright_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
+	HUILeftRightData* leftright = data;
+	Pixels padding = leftright->padding;
+	Element* left = hui_first_child(frame->element);
+	Element* right = left ? hui_next_sibling(left) : NULL;
+
+	Pixels width = constraints_width(frame->constraints);
+	Constraints intrinsic = {
+		.width = UNSET,
+		.height = UNSET,
+		.max_width = width,
+		.max_height = constraints_height(frame->constraints),
+	};
+	Constraints clamped = intrinsic;
+	clamped.width = width;
 
-	right->compute_layout(right, right+1);
-	if (x + right->layout.width > layout->x + layout->width) { // Does not fit horizontally
-		if(right->layout.width > layout->width) {
-			right->layout.width = layout->width;
-			right->layout.height = UNSET;
+	// Steps: the left child is measured in 1 and 2, and the right one in 3 and 4
+	if (frame->step == 0) {
+		if(!left || !right || hui_next_sibling(right)) {
+			panic("Leftright must have exactly two children.");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, left, intrinsic, &child_size);
+		if (frame == NULL) return;
+	}
+	if (frame->step == 1 && child_size.width > width) {
+		frame->step = 2;
+		frame = measure_child(frame, left, clamped, &child_size);
+		if (frame == NULL) return;
+	}
+	if (frame->step <= 2) {
+		frame->state.left = child_size;
+		frame->step = 3;
+		frame = measure_child(frame, right, intrinsic, &child_size);
+		if (frame == NULL) return;
+	}
+	if (frame->step == 3) {
+		leftright->wrapped = frame->state.left.width + padding + child_size.width > width; // Does not fit horizontally
+		if (leftright->wrapped && child_size.width > width) {
+			frame->step = 4;
+			frame = measure_child(frame, right, clamped, &child_size);
+			if (frame == NULL) return;
 		}
-		x = layout->x + layout->width - right->layout.width;
-		y = layout->y + left->layout.height + padding;
-		wrapped = true;
-	}
-	else { // Does fit horizontally
-		x = layout->x + layout->width - right->layout.width;
-		y = layout->y;
-		wrapped = false;
 	}
 
-	right->layout.x = x;
-	right->layout.y = y;
-	right->compute_layout(right, right+1);
-
-	if (wrapped) {
-		layout->height = left->layout.height + right->layout.height + padding;
+	Size left_size = frame->state.left;
+	Size right_size = child_size;
+	Pixels height;
+	if (leftright->wrapped) {
+		height = left_size.height + right_size.height + padding;
+	} else if (left_size.height > right_size.height) {
+		height = left_size.height;
 	} else {
-		if(left->layout.height > right->layout.height) {
-			layout->height = left->layout.height;
-		} else {
-			layout->height = right->layout.height;
-		}
+		height = right_size.height;
 	}
-
-	return result;
+	measure_done(frame, (Size) { .width = width, .height = height });
 }
 
-void hui_leftright_draw(Element* el, void* data) {
-	(void) data;
-	Element* left = el->first_child;
-	left->draw(left, left+1);
-	Element* right = left->next_sibling;
-	right->draw(right, right+1);
+void hui_leftright_arrange(Element* el, void* data) {
+	HUILeftRightData* leftright = data;
+	Layout* layout = hui_layout(el);
+	Element* left = hui_first_child(el);
+	Element* right = hui_next_sibling(left);
+
+	hui_arrange(left, layout->x, layout->y);
+	Pixels right_y = leftright->wrapped ? layout->y + hui_layout(left)->height + leftright->padding : layout->y;
+	hui_arrange(right, layout->x + layout->width - hui_layout(right)->width, right_y);
 }
 
 void hui_leftright_start(Pixels padding) {
-	Element* element = push_element(sizeof(Pixels));
-	element->compute_layout = hui_leftright_layout;
-	element->draw = hui_leftright_draw;
-	*(Pixels*)get_element_data(element) = padding;
+	Element* element = push_element(HUI_KIND_LEFTRIGHT, sizeof(HUILeftRightData));
+	*(HUILeftRightData*)get_element_data(element) = (HUILeftRightData) { .padding = padding, .wrapped = false };
 	start_adding_children();
 }
 
@@ -378,31 +372,27 @@ void hui_leftright_end() {
 	stop_adding_children();
 }
 
-LayoutResult hui_fixed_layout(Element* el, void* data) {
-	Layout* layout = &el->layout;
+void hui_fixed_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
 	Pixels* size = (Pixels*)data;
-	if (!el->first_child || el->first_child->next_sibling) {
-		panic("hui_fixed must have exactly one child");
+	if (frame->step == 0) {
+		Element* el = frame->element;
+		if (!hui_first_child(el) || hui_next_sibling(hui_first_child(el))) {
+			panic("hui_fixed must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, hui_first_child(el), (Constraints) { .width = size[0], .height = size[1], .max_width = size[0], .max_height = size[1] }, &child_size);
+		if (frame == NULL) return;
 	}
-	layout->width = size[0];
-	layout->height = size[1];
-	el->first_child->layout.x = layout->x;
-	el->first_child->layout.y = layout->y;
-	el->first_child->layout.width = size[0];
-	el->first_child->layout.height = size[1];
-	el->first_child->compute_layout(el->first_child, el->first_child+1);
-	return LAYOUT_OK;
+	measure_done(frame, (Size) { .width = size[0], .height = size[1] });
 }
 
-void hui_fixed_draw(Element* el, void* data) {
+void hui_fixed_arrange(Element* el, void* data) {
 	(void) data;
-	el->first_child->draw(el->first_child, el->first_child+1);
+	hui_arrange(hui_first_child(el), hui_layout(el)->x, hui_layout(el)->y);
 }
 
 void hui_fixed_start(Pixels width, Pixels height) {
-	Element* element = push_element(sizeof(Pixels)*2);
-	element->compute_layout = hui_fixed_layout;
-	element->draw = hui_fixed_draw;
+	Element* element = push_element(HUI_KIND_FIXED, sizeof(Pixels)*2);
 	Pixels* data = get_element_data(element);
 	data[0] = width;
 	data[1] = height;
@@ -412,28 +402,34 @@ void hui_fixed_end() {
 	stop_adding_children();
 }
 
-LayoutResult hui_scroll_layout(Element* el, void* data) {
-	Pixels* offset = *(Pixels**)data;
-	Layout* layout = &el->layout;
-	LayoutResult result = LAYOUT_OK;
-
-	if(!el->first_child || el->first_child->next_sibling) {
-		panic("hui_scroll must have exactly one child");
-	}
-
-	Element* child = el->first_child;
-	child->layout.x = layout->x;
-	child->layout.y = layout->y - *offset;
-
-	child->compute_layout(child, child+1);
+void hui_scroll_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
+	(void) data;
+	Constraints constraints = frame->constraints;
+	if (frame->step == 0) {
+		Element* el = frame->element;
+		if(!hui_first_child(el) || hui_next_sibling(hui_first_child(el))) {
+			panic("hui_scroll must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, hui_first_child(el), (Constraints) {
+			.width = UNSET,
+			.height = UNSET,
+			.max_width = constraints_width(constraints),
+			.max_height = constraints_height(constraints),
+		}, &child_size);
+		if (frame == NULL) return;
+	}
+
+	measure_done(frame, (Size) {
+		.width = is_unset(constraints.width) ? child_size.width : constraints.width,
+		.height = is_unset(constraints.height) ? child_size.height : constraints.height,
+	});
+}
 
-	if(is_unset(layout->width)) {
-		layout->width = child->layout.width;
-	}
-	if(is_unset(layout->height)) {
-		layout->height = child->layout.height;
-	}
-	return result;
+// The offset only affects the position, so it can change without measuring again.
+void hui_scroll_arrange(Element* el, void* data) {
+	Pixels* offset = *(Pixels**)data;
+	hui_arrange(hui_first_child(el), hui_layout(el)->x, hui_layout(el)->y - *offset);
 }
 
 // These variables are used so that only one scroll is handled with the wheel at a time
@@ -442,16 +438,22 @@ Pixels last_scrolled_prev_offset = UNSET;
 
 void hui_scroll_draw(Element* el, void* data) {
 	(void) data;
-	BeginScissorMode(el->layout.x, el->layout.y, el->layout.width, el->layout.height);
-		Element* child = el->first_child;
-		child->draw(child, child+1);
-	EndScissorMode();
+	Layout* layout = hui_layout(el);
+	hui_begin_scissor(*layout);
+}
+
+void hui_scroll_draw_end(Element* el, void* data) {
+	(void) el;
+	(void) data;
+	hui_end_scissor();
 }
 
 void hui_scroll_handle(Element* el, void* data) {
 	Pixels* offset = *(Pixels**)data;
+	Layout* layout = hui_layout(el);
+	Pixels drawn_offset = *offset;
 
-	if (CheckCollisionPointRec(GetMousePosition(), el->layout)) {
+	if (hui_hovered(el)) {
 		if(last_scrolled_offset != NULL && last_scrolled_offset != offset) {
 			*last_scrolled_offset = last_scrolled_prev_offset;
 		}
@@ -459,22 +461,22 @@ void hui_scroll_handle(Element* el, void* data) {
 		last_scrolled_offset = offset;
 		last_scrolled_prev_offset = *offset;
 
-		Pixels dy = -GetMouseWheelMoveV().y * 1500 * frame_time;
+		Pixels dy = -frame_input.wheel.y * 1500 * frame_input.frame_time;
 
 		*offset += dy;
 	}
-	if (*offset > el->first_child->layout.height - el->layout.height) *offset = el->first_child->layout.height - el->layout.height;
+	Pixels max_offset = hui_layout(hui_first_child(el))->height - layout->height;
+	if (*offset > max_offset) *offset = max_offset;
 	if (*offset < 0) *offset = 0;
+	if (*offset != drawn_offset) hui_request_redraw();
 }
 
 void hui_scroll_start(Pixels* offset) {
 	last_scrolled_offset = NULL;
-	Element* element = push_element(sizeof(Pixels*));
-	element->compute_layout = hui_scroll_layout;
-	element->draw = hui_scroll_draw;
+	Element* element = push_element(HUI_KIND_SCROLL, sizeof(Pixels*));
 	*(Pixels**)get_element_data(element) = offset;
 	push_handler(hui_scroll_handle, element);
-	start_bounding_box(&element->layout);
+	start_bounding_box(element);
 	start_adding_children();
 }
 
@@ -482,3 +484,170 @@ void hui_scroll_end() {
 	stop_adding_children();
 	end_bounding_box();
 }
+
+// Items built above the first one, and after the last one in view
+#define HUI_VIRTUAL_LIST_OVERSCAN 2
+
+typedef struct {
+	HUIVirtualList* list;
+	usize count;
+	usize built_first; // The index of the first child
+	usize first; // Of the list, when built
+	Pixels first_offset;
+	Pixels estimated_height;
+	Pixels gap;
+} HUIVirtualListData;
+
+// As laid out in the last frame, or estimated
+Pixels virtual_list_item_height(HUIVirtualList* list, usize item, Pixels estimated_height) {
+	if (item >= list->built_first && item - list->built_first < list->built_heights.len) {
+		return ((Pixels*)list->built_heights.data)[item - list->built_first];
+	}
+	return estimated_height;
+}
+
+// Moves first to the item at the top of the list, only looking at the items in between
+void virtual_list_move_first(HUIVirtualList* list, usize count, Pixels estimated_height, Pixels gap) {
+	while (list->first_offset < 0 && list->first > 0) {
+		list->first--;
+		list->first_offset += virtual_list_item_height(list, list->first, estimated_height) + gap;
+	}
+	while (list->first + 1 < count && list->first_offset >= virtual_list_item_height(list, list->first, estimated_height) + gap) {
+		list->first_offset -= virtual_list_item_height(list, list->first, estimated_height) + gap;
+		list->first++;
+	}
+	if (list->first_offset < 0) list->first_offset = 0;
+}
+
+// Keeps the list from scrolling past either end
+void virtual_list_scroll(HUIVirtualList* list, usize count, Pixels estimated_height, Pixels gap) {
+	if (count == 0) {
+		list->first = 0;
+		list->first_offset = 0;
+		return;
+	}
+	if (list->first >= count) {
+		list->first = count - 1;
+		list->first_offset = 0;
+	}
+	virtual_list_move_first(list, count, estimated_height, gap);
+
+	// If the bottom of the last item is in view, it is moved down to the bottom of the list
+	Pixels bottom = -list->first_offset;
+	usize item = list->first;
+	for (; item < count && bottom < list->height; item++) {
+		bottom += virtual_list_item_height(list, item, estimated_height) + gap;
+	}
+	bottom -= gap;
+	if (item == count && bottom < list->height) {
+		list->first_offset -= list->height - bottom;
+		virtual_list_move_first(list, count, estimated_height, gap);
+	}
+}
+
+void hui_virtual_list_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
+	(void) data;
+	Constraints constraints = frame->constraints;
+	Pixels width = constraints_width(constraints);
+	Constraints child_constraints = {
+		.width = width,
+		.height = UNSET,
+		.max_width = width,
+		.max_height = constraints_height(constraints),
+	};
+
+	Element* child = frame->step == 0 ? hui_first_child(frame->element) : hui_next_sibling(frame->child);
+	frame->step = 1;
+	for (; child != NULL; child = hui_next_sibling(child)) {
+		frame = measure_child(frame, child, child_constraints, &child_size);
+		if (frame == NULL) return;
+	}
+	measure_done(frame, (Size) { .width = width, .height = constraints_height(constraints) });
+}
+
+// The first item is at the top, and the ones built above it are above the list
+void hui_virtual_list_arrange(Element* el, void* data) {
+	HUIVirtualListData* list_data = data;
+	Layout* layout = hui_layout(el);
+	Pixels y = layout->y - list_data->first_offset;
+	Element* child = hui_first_child(el);
+	for (usize item = list_data->built_first; item < list_data->first && child != NULL; item++) {
+		y -= hui_layout(child)->height + list_data->gap;
+		child = hui_next_sibling(child);
+	}
+	for (child = hui_first_child(el); child != NULL; child = hui_next_sibling(child)) {
+		hui_arrange(child, layout->x, y);
+		y += hui_layout(child)->height + list_data->gap;
+	}
+}
+
+// Remembers the heights of the items built, for the next frame, then scrolls
+void hui_virtual_list_handle(Element* el, void* data) {
+	HUIVirtualListData* list_data = data;
+	HUIVirtualList* list = list_data->list;
+	Layout* layout = hui_layout(el);
+	list->height = layout->height;
+	list->built_first = list_data->built_first;
+	hvec_clear(&list->built_heights);
+	for (Element* child = hui_first_child(el); child != NULL; child = hui_next_sibling(child)) {
+		hvec_push(&list->built_heights, &hui_layout(child)->height);
+	}
+
+	if (hui_hovered(el)) {
+		// Scrolls inside of the items are not supported, so it is always the innermost one
+		if (last_scrolled_offset != NULL) {
+			*last_scrolled_offset = last_scrolled_prev_offset;
+			last_scrolled_offset = NULL;
+		}
+		list->first_offset += -frame_input.wheel.y * 1500 * frame_input.frame_time;
+	}
+	virtual_list_scroll(list, list_data->count, list_data->estimated_height, list_data->gap);
+	// The recorded heights can move it too, not only the wheel
+	if (list->first != list_data->first || list->first_offset != list_data->first_offset) hui_request_redraw();
+}
+
+void hui_virtual_list(HUIVirtualList* list, usize count, Pixels estimated_height, Pixels gap, void (*build)(usize index, void* user), void* user) {
+	if (list->built_heights.element_size == 0) {
+		list->built_heights = hvec_new(sizeof(Pixels));
+	}
+	// The count may have changed since the last frame
+	virtual_list_scroll(list, count, estimated_height, gap);
+	Pixels height = list->height > 0 ? list->height : backend.screen_size().height; // Not laid out yet
+
+	usize built_first = list->first > HUI_VIRTUAL_LIST_OVERSCAN ? list->first - HUI_VIRTUAL_LIST_OVERSCAN : 0;
+	Element* element = push_element(HUI_KIND_VIRTUAL_LIST, sizeof(HUIVirtualListData));
+	*(HUIVirtualListData*)get_element_data(element) = (HUIVirtualListData) {
+		.list = list,
+		.count = count,
+		.built_first = built_first,
+		.first = list->first,
+		.first_offset = list->first_offset,
+		.estimated_height = estimated_height,
+		.gap = gap,
+	};
+	push_handler(hui_virtual_list_handle, element);
+	start_bounding_box(element);
+	start_adding_children();
+
+	Pixels bottom = -list->first_offset; // Of the items built, from the top of the list
+	usize below = 0; // Items built past the bottom of the list
+	for (usize item = built_first; item < count && below < HUI_VIRTUAL_LIST_OVERSCAN; item++) {
+		u32 index = current_frame->elements.len;
+		build(item, user);
+		if (current_frame->elements.len == index || prev_sibling != index) {
+			panic("hui_virtual_list: build must build exactly one element");
+		}
+		if (item >= list->first) {
+			if (bottom >= height) below++;
+			bottom += virtual_list_item_height(list, item, estimated_height) + gap;
+		}
+	}
+
+	stop_adding_children();
+	end_bounding_box();
+}
+
+void hui_virtual_list_free(HUIVirtualList* list) {
+	if (list->built_heights.element_size != 0) hvec_free(&list->built_heights);
+	*list = (HUIVirtualList) {0};
+}
@@ -1,4 +1,8 @@
 #include "./layouts.c"
 #include "./widgets.c"
 #include "./core.c"
+#include "./atlas.c"
 #include "./text.c"
+#include "./memo.c"
+#include "./backend.c"
+#include "./draw.c"
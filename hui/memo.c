@@ -0,0 +1,159 @@
+#include "hui.h"
+#include "core.c"
+#include <string.h>
+
+typedef struct {
+	void (*handler)(Element*, void*);
+	u32 index; // Relative to the memo element
+	bool hover;
+} HUIMemoHandler;
+
+// The subtree of an element is contiguous, both in the elements and in the data buffer,
+// so a memo only has to remember how long its subtree is to copy it.
+typedef struct {
+	u64 hash;
+	bool spliced; // The subtree was copied from the previous frame
+	u32 elements_len;
+	u32 data_len; // Including the handlers
+	u32 handlers; // Offset of the handlers in the data buffer, relative to the memo's data
+	u32 handlers_len;
+	usize handlers_start; // Index into functions_vec, only used while building
+} HUIMemoData;
+
+#define HUI_MEMO_DATA_SIZE ((sizeof(HUIMemoData) + 7) & ~(usize)7)
+
+// If the constraints did not change, this is not called at all, see hui_measure.
+// The caches of the copied subtree are still valid, as measuring only depends on the constraints.
+void hui_memo_measure(HUIMeasureFrame* frame, Size child_size, void* data) {
+	(void) data;
+	Constraints constraints = frame->constraints;
+	if (frame->step == 0) {
+		Element* el = frame->element;
+		if (hui_first_child(el) == NULL || hui_next_sibling(hui_first_child(el)) != NULL) {
+			panic("Memo must have exactly one child");
+		}
+		frame->step = 1;
+		frame = measure_child(frame, hui_first_child(el), constraints, &child_size);
+		if (frame == NULL) return;
+	}
+	measure_done(frame, (Size) {
+		.width = is_unset(constraints.width) ? child_size.width : constraints.width,
+		.height = is_unset(constraints.height) ? child_size.height : constraints.height,
+	});
+}
+
+void hui_memo_arrange(Element* el, void* data) {
+	(void) data;
+	hui_arrange(hui_first_child(el), hui_layout(el)->x, hui_layout(el)->y);
+}
+
+
+u32 memo_shift(u32 index, i64 offset) {
+	return index == HUI_NO_ELEMENT ? index : (u32)(index + offset);
+}
+
+// The previous frame is cleared on the next frame, so the subtree has to be copied.
+// Everything is copied as a block, and only the indices and offsets are fixed.
+void memo_splice(u32 index, HUIFrame* old_frame, u32 old_index) {
+	HUIMemoData old_memo = *(HUIMemoData*)((u8*)old_frame->data.data + ((Element*)old_frame->elements.data)[old_index].data);
+	u32 start = index + 1;
+	u32 old_start = old_index + 1;
+	u32 len = old_memo.elements_len;
+	i64 element_offset = (i64)start - old_start;
+	i64 data_offset = (i64)current_frame->data.len - (((Element*)old_frame->elements.data)[old_index].data + HUI_MEMO_DATA_SIZE);
+	u32 outer_bounding_box = bounding_box_top();
+
+	Element* elements = hvec_extend(&current_frame->elements, (Element*)old_frame->elements.data + old_start, len);
+	// The cache and layout are what allow skipping the layout of the whole subtree
+	hvec_extend(&current_frame->layouts, (Layout*)old_frame->layouts.data + old_start, len);
+	hvec_extend(&current_frame->layout_caches, (LayoutCache*)old_frame->layout_caches.data + old_start, len);
+	hvec_extend(&current_frame->data, (u8*)old_frame->data.data + elements[0].data, old_memo.data_len);
+	*hui_layout(element_at(index)) = ((Layout*)old_frame->layouts.data)[old_index];
+	*layout_cache(element_at(index)) = ((LayoutCache*)old_frame->layout_caches.data)[old_index];
+
+	for (u32 i = 0; i < len; i++) {
+		Element* element = &elements[i];
+		element->parent = memo_shift(element->parent, element_offset);
+		element->first_child = memo_shift(element->first_child, element_offset);
+		element->next_sibling = memo_shift(element->next_sibling, element_offset);
+		element->data = element->data + data_offset;
+		if (element->bounding_box >= old_start && element->bounding_box < old_start + len) {
+			element->bounding_box = element->bounding_box + element_offset;
+		} else {
+			element->bounding_box = outer_bounding_box;
+		}
+		if (element->kind == HUI_KIND_MEMO) {
+			u32 nested = start + i;
+			hhashmap_set(&current_frame->memos, &element->id, &nested);
+		}
+	}
+
+	HUIMemoData* memo = get_element_data(element_at(index));
+	memo->spliced = true;
+	memo->elements_len = old_memo.elements_len;
+	memo->data_len = old_memo.data_len;
+	memo->handlers = old_memo.handlers;
+	memo->handlers_len = old_memo.handlers_len;
+	HUIMemoHandler* handlers = (HUIMemoHandler*)((u8*)memo + memo->handlers);
+	for (u32 i = 0; i < memo->handlers_len; i++) {
+		add_handler(handlers[i].handler, element_at(index + handlers[i].index), handlers[i].hover);
+	}
+
+	// As if the child had been built
+	element_at(index)->first_child = start;
+	parent = HUI_NO_ELEMENT;
+	prev_sibling = start;
+}
+
+bool hui_memo_start(ElementId id, u64 hash) {
+	Element* element = push_element(HUI_KIND_MEMO, sizeof(HUIMemoData));
+	element->id = id;
+	*(HUIMemoData*)get_element_data(element) = (HUIMemoData) {
+		.hash = hash,
+		.spliced = false,
+		.elements_len = 0,
+		.data_len = 0,
+		.handlers = 0,
+		.handlers_len = 0,
+		.handlers_start = functions_vec.len,
+	};
+	u32 index = element_index(element);
+	hhashmap_set(&current_frame->memos, &id, &index);
+	start_adding_children();
+
+	HUIFrame* old_frame = &frames[1 - current_frame_index];
+	u32* old_index = hhashmap_get(&old_frame->memos, &id);
+	if (old_index != NULL) {
+		Element* old = (Element*)old_frame->elements.data + *old_index;
+		if (((HUIMemoData*)((u8*)old_frame->data.data + old->data))->hash == hash) {
+			memo_splice(index, old_frame, *old_index);
+			return false;
+		}
+	}
+	return true;
+}
+
+void hui_memo_end() {
+	stop_adding_children();
+	u32 index = prev_sibling;
+	Element* element = element_at(index);
+	HUIMemoData* memo = get_element_data(element);
+	if (memo->spliced) return;
+
+	// Handlers are stored after the subtree's data, so that they are copied along with it
+	usize handlers_start = memo->handlers_start;
+	usize handlers_len = functions_vec.len - handlers_start;
+	u32 memo_data = element->data;
+	u32 handlers = current_frame->data.len - memo_data;
+	HUIMemoHandler* copy = hvec_extend(&current_frame->data, NULL, (handlers_len * sizeof(HUIMemoHandler) + 7) & ~(usize)7);
+	for (usize i = 0; i < handlers_len; i++) {
+		Handler* handler = hvec_at(&functions_vec, handlers_start + i);
+		copy[i] = (HUIMemoHandler) { .handler = handler->handler, .index = handler->element - index, .hover = handler->hover };
+	}
+
+	memo = (HUIMemoData*)((u8*)current_frame->data.data + memo_data);
+	memo->elements_len = current_frame->elements.len - (index + 1);
+	memo->data_len = current_frame->data.len - (memo_data + HUI_MEMO_DATA_SIZE);
+	memo->handlers = handlers;
+	memo->handlers_len = handlers_len;
+}
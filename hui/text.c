@@ -1,228 +1,551 @@
 #include "hui.h"
 #include "core.c"
 #include "../hlib/hhashmap.h"
+#include <string.h>
+#include <math.h>
 
 HHashMap hui_text_cache = {0};
 
+u64 hash_mix(u64 hash, u64 word) {
+	return (hash ^ word) * 0x9E3779B97F4A7C15;
+}
+
+// Computed once per text element, when it is built. Reads 8 bytes at a time, in four independent
+// lanes so that the multiplications overlap. Hits are verified against the text, so collisions
+// only cost a miss.
 u64 hash_str(str text) {
-	u64 result = 0;
-	for(usize i = 0; i < text.len; i++) {
-		result ^= result*256 + ((u64)text.data[i]);
+	u64 lanes[4] = { text.len, 0x243F6A8885A308D3, 0x13198A2E03707344, 0xA4093822299F31D0 };
+	usize i = 0;
+	for (; i + 32 <= text.len; i += 32) {
+		u64 words[4];
+		memcpy(words, text.data + i, 32);
+		for (usize lane = 0; lane < 4; lane++) {
+			lanes[lane] = hash_mix(lanes[lane], words[lane]);
+		}
+	}
+	u64 hash = lanes[0] ^ (lanes[1] >> 7) ^ (lanes[2] >> 13) ^ (lanes[3] >> 29);
+	for (; i + 8 <= text.len; i += 8) {
+		u64 word;
+		memcpy(&word, text.data + i, 8);
+		hash = hash_mix(hash, word);
 	}
-	return result;
+	if (i < text.len) {
+		u64 word = 0;
+		memcpy(&word, text.data + i, text.len - i);
+		hash = hash_mix(hash, word);
+	}
+	hash ^= hash >> 32;
+	return hash;
 }
 
 typedef struct {
-	bool used;
-	Pixels height;
-	Pixels actual_width;
-	Pixels next_glyph_x;
-	Pixels next_glyph_y;
-	i64 last_frame; // Used for cache invalidation.
-	RenderTexture2D texture;
-} HUITextCacheValue;
+	char* path;
+	int size;
+	Font font;
+} HUIFontEntry;
+
+HVec fonts = {0}; // HUIFontEntry, a HUIFont is its index plus one
+
+HUIFont hui_load_font(const char* path, int size) {
+	if (fonts.element_size == 0) {
+		fonts = hvec_new(sizeof(HUIFontEntry));
+	}
+	for (usize i = 0; i < fonts.len; i++) {
+		HUIFontEntry* entry = hvec_at(&fonts, i);
+		if (entry->size == size && strcmp(entry->path, path) == 0) return i + 1;
+	}
+	usize path_len = strlen(path);
+	HUIFontEntry entry = { .path = malloc(path_len + 1), .size = size, .font = backend.load_font(path, size) };
+	nullpanic(entry.path);
+	memcpy(entry.path, path, path_len + 1);
+	hvec_push(&fonts, &entry);
+	return fonts.len;
+}
+
+Font backend_font(HUIFont font) {
+	if (font == 0) return (Font) {0};
+	HUIFontEntry* entry = hvec_at(&fonts, font - 1);
+	assert(entry != NULL);
+	return entry->font;
+}
+
+void fonts_free() {
+	if (fonts.element_size == 0) return;
+	for (usize i = 0; i < fonts.len; i++) {
+		HUIFontEntry* entry = hvec_at(&fonts, i);
+		backend.unload_font(entry->font);
+		free(entry->path);
+	}
+	hvec_free(&fonts);
+	fonts = (HVec) {0};
+}
+
+typedef struct {
+	Pixels   x;
+	Pixels   y;
+	int      codepoint;
+	u32      atlas_generation; // Of glyph, 0 if it was not looked up yet. Unique to an atlas.
+	HUIGlyph glyph; // Looked up when drawn, see draw_text_glyphs
+} HUIGlyphPosition;
+
+// The advances of the ASCII glyphs of a font and size, so that most text is laid out without
+// decoding UTF-8 or calling the backend for each glyph.
+typedef struct {
+	HUIFont font;
+	Pixels font_size;
+	u64 last_used; // 0 if the slot is empty
+	Pixels advances[128];
+} HUIAdvanceTable;
+
+// The sizes change continuously while zooming, so only the most recently used are kept
+#define HUI_ADVANCE_TABLES 16
+
+HUIAdvanceTable advance_tables[HUI_ADVANCE_TABLES] = {0};
+u64 advance_tables_clock = 0;
+
+// Valid until another table is added
+Pixels* advance_table(HUIFont font, Pixels font_size) {
+	advance_tables_clock++;
+	HUIAdvanceTable* oldest = &advance_tables[0];
+	for (usize i = 0; i < HUI_ADVANCE_TABLES; i++) {
+		HUIAdvanceTable* table = &advance_tables[i];
+		if (table->last_used != 0 && table->font == font && table->font_size == font_size) {
+			table->last_used = advance_tables_clock;
+			return table->advances;
+		}
+		if (table->last_used < oldest->last_used) oldest = table;
+	}
+	oldest->font = font;
+	oldest->font_size = font_size;
+	oldest->last_used = advance_tables_clock;
+	for (int chr = 0; chr < 128; chr++) {
+		oldest->advances[chr] = backend.glyph_advance(backend_font(font), chr, font_size);
+	}
+	return oldest->advances;
+}
 
+// Hashed as bytes, so it is zeroed before being filled in, see text_layout_cached.
+// The width is not part of it, see HUITextCacheValue.
 typedef struct {
 	u64 hash;
-	Pixels width;
+	HUIFont font;
 	Pixels font_size;
 	Pixels first_line_indent;
-	// TODO: Add font
 } HUITextCacheKey;
 
-#define HUI_TEXT_CACHE_SIZE 256
-HUITextCacheKey keys[HUI_TEXT_CACHE_SIZE] = {0};
-HUITextCacheValue values[HUI_TEXT_CACHE_SIZE] = {0};
+// Only the positions of the glyphs are computed here, on the CPU, so that layout does not rasterize
+// anything. They are drawn from the glyph atlas (see atlas.c).
+// The lines break at the same glyphs for any width in [min_width, max_width), so the entry is used
+// for all of them, and resizing only lays out again the text whose lines actually change.
+// The entries of a key with different line breaks are chained by next_width.
+typedef struct {
+	bool used;
+	bool wrapped;
+	Pixels min_width;
+	Pixels max_width;
+	Pixels height;
+	Pixels line_width; // If not wrapped
+	Pixels next_glyph_x;
+	Pixels next_glyph_y;
+	i64 last_frame; // Entries used in the current frame are never evicted
+	u32 version; // Changes when the entry is populated again, see HUITextCacheRef
+	u32 slot; // In text_cache_entries
+	u32 next_width; // HUI_TEXT_CACHE_NONE at the end
+	u32 newer; // In the LRU list, HUI_TEXT_CACHE_NONE at the ends
+	u32 older;
+	usize bytes; // Of text and glyphs, counted against the budget
+	HUITextCacheKey key; // To remove it from the map when evicted
+	HVec text; // char, a copy of the text, to verify hits
+	HVec glyphs; // HUIGlyphPosition
+} HUITextCacheValue;
 
-usize hui_get_text_cache_cap() {
-	return HUI_TEXT_CACHE_SIZE;
+// The entry used when measuring, so that drawing does not look it up again.
+typedef struct {
+	HUITextCacheValue* value;
+	u32 version;
+} HUITextCacheRef;
+
+// The cache grows until its entries take more than the budget, then the least recently used ones
+// are evicted and their slots reused. The ones used in the current frame are never evicted, so the
+// budget can be exceeded until the next frame.
+// The entries are allocated one by one, so that HUITextCacheRef can point to them while it grows.
+#define HUI_TEXT_CACHE_NONE ((u32)-1)
+#define HUI_TEXT_CACHE_DEFAULT_BUDGET (8 << 20)
+
+HVec text_cache_entries = {0}; // HUITextCacheValue*
+HVec text_cache_free_slots = {0}; // u32
+// hui_text_cache maps HUITextCacheKey -> u32, the slot in text_cache_entries of the first entry
+u32 text_cache_newest = HUI_TEXT_CACHE_NONE;
+u32 text_cache_oldest = HUI_TEXT_CACHE_NONE;
+u32 text_cache_version = 0;
+HUITextCacheStats text_cache_stats = { .budget = HUI_TEXT_CACHE_DEFAULT_BUDGET };
+HUITextCacheRef cursor_text_edited = {0}; // The last entry a cursor text laid out, see hui_cursor_text
+
+HUITextCacheValue* text_cache_entry(u32 slot) {
+	return *(HUITextCacheValue**)hvec_at(&text_cache_entries, slot);
 }
 
 usize hui_get_text_cache_used() {
-	usize count = 0;
-	for(usize i = 0; i < HUI_TEXT_CACHE_SIZE; i++) {
-		if (values[i].used) count++;
-	}
-	return count;
+	return text_cache_stats.entries;
 }
 
-u64 hash_key(HUITextCacheKey key) {
-	// The font_size and width is not considered for the cache because it makes it so that,
-	// upon resizing or changing the font size slightly, the same slot is used,
-	// which has an already existing texture which most likely can fit the slightly changed result.
-	// See the populate_cache for more details.
-	return key.hash; // ^ *(u64*)&key.font_size ^*(u64*)&key.width;
+HUITextCacheStats hui_get_text_cache_stats() {
+	HUITextCacheStats stats = text_cache_stats;
+	stats.atlas_bytes = atlas_bytes();
+	stats.atlas_bytes_saved = atlas_bytes_saved();
+	return stats;
 }
 
-#define HUI_TEXT_CACHE_GIVE_UP 20
-HUITextCacheValue* populate_cache(str text, u64 text_hash, Pixels first_line_indent, Pixels width, Pixels font_size, u64 key_hash) {
-	u64 index = key_hash % HUI_TEXT_CACHE_SIZE;
-	i64 frame_num = hui_get_frame_num();
-	usize safety;
-	for(safety = 0; safety < HUI_TEXT_CACHE_GIVE_UP; safety++) {
-		if (values[index].last_frame < hui_get_frame_num()-2) { // Two frame presistance
-			values[index].used = false;
-		}
-		if (!values[index].used) break;
-		index = (index+1) % HUI_TEXT_CACHE_SIZE;
-	}
-	Pixels x = first_line_indent;
-	Pixels y = 0;
+void text_cache_unlink(u32 slot) {
+	HUITextCacheValue* value = text_cache_entry(slot);
+	if (value->newer != HUI_TEXT_CACHE_NONE) text_cache_entry(value->newer)->older = value->older;
+	else text_cache_newest = value->older;
+	if (value->older != HUI_TEXT_CACHE_NONE) text_cache_entry(value->older)->newer = value->newer;
+	else text_cache_oldest = value->newer;
+}
 
-	// Assuming square glyphs, the height needed to fit al the characters in the given width
-	Pixels tentative_height = text.len * font_size*font_size / width;
+void text_cache_link_newest(u32 slot) {
+	HUITextCacheValue* value = text_cache_entry(slot);
+	value->newer = HUI_TEXT_CACHE_NONE;
+	value->older = text_cache_newest;
+	if (text_cache_newest != HUI_TEXT_CACHE_NONE) text_cache_entry(text_cache_newest)->newer = slot;
+	else text_cache_oldest = slot;
+	text_cache_newest = slot;
+}
 
-	tentative_height += font_size; // Extra line of margin, because the previous calculation assumes that all lines are filled.
+void text_cache_touch(u32 slot) {
+	text_cache_entry(slot)->last_frame = hui_get_frame_num();
+	if (text_cache_newest == slot) return;
+	text_cache_unlink(slot);
+	text_cache_link_newest(slot);
+}
 
-	Font font = GetFontDefault();
-	f32 scale_factor = font_size/(f32)font.baseSize;
+// Removes the entry from the map and the LRU list, but keeps its text and glyphs
+void text_cache_remove(u32 slot) {
+	HUITextCacheValue* value = text_cache_entry(slot);
+	text_cache_unlink(slot);
+	u32* first = hhashmap_get(&hui_text_cache, &value->key);
+	if (*first == slot) {
+		if (value->next_width == HUI_TEXT_CACHE_NONE) hhashmap_delete(&hui_text_cache, &value->key);
+		else *first = value->next_width;
+	} else {
+		HUITextCacheValue* previous = text_cache_entry(*first);
+		while (previous->next_width != slot) previous = text_cache_entry(previous->next_width);
+		previous->next_width = value->next_width;
+	}
+}
 
-	if (
-			(values[index].texture.texture.width > width && values[index].texture.texture.width < 2*width)
-			&& (values[index].texture.texture.height > tentative_height && values[index].texture.texture.height < 2*tentative_height)
-		) {
-		// There is already a texture and it is roughly the same size as we need, so we can reuse it.
-		// Becuase we only use the text as a hash, this means that if the font size or the width changes a small bit,
-		// we will likely reuse the same texture, saving the time of Unloading and Loading textures to the GPU.
+// Evicts from the least recently used, until the cache fits in the budget
+void text_cache_trim() {
+	i64 frame_num = hui_get_frame_num();
+	while (text_cache_stats.bytes > text_cache_stats.budget && text_cache_oldest != HUI_TEXT_CACHE_NONE) {
+		u32 slot = text_cache_oldest;
+		HUITextCacheValue* value = text_cache_entry(slot);
+		if (value->last_frame == frame_num) break; // So are all the newer ones
+		text_cache_remove(slot);
+		hvec_free(&value->text);
+		hvec_free(&value->glyphs);
+		text_cache_stats.bytes -= value->bytes;
+		text_cache_stats.entries--;
+		text_cache_stats.evictions++;
+		value->used = false;
+		value->bytes = 0;
+		*(u32*)stack_push(&text_cache_free_slots) = slot;
 	}
-	else {
-		if (values[index].texture.texture.width) {
-			// There is already a texture, but it is too large or too small
-			UnloadRenderTexture(values[index].texture);
+}
+
+void hui_set_text_cache_budget(usize bytes) {
+	text_cache_stats.budget = bytes;
+	text_cache_trim();
+}
+
+void text_cache_free() {
+	memset(advance_tables, 0, sizeof(advance_tables));
+	advance_tables_clock = 0;
+	for (usize i = 0; i < text_cache_entries.len; i++) {
+		HUITextCacheValue* value = text_cache_entry(i);
+		if (value->used) {
+			hvec_free(&value->text);
+			hvec_free(&value->glyphs);
 		}
-		values[index].texture = LoadRenderTexture(width*1.5, tentative_height*1.5); // Extra space is added, so it can be reused both it the text grows, or shrinks
+		free(value);
+	}
+	if (text_cache_entries.element_size != 0) {
+		hvec_free(&text_cache_entries);
+		hvec_free(&text_cache_free_slots);
+		hhashmap_free(&hui_text_cache);
+	}
+	text_cache_newest = HUI_TEXT_CACHE_NONE;
+	text_cache_oldest = HUI_TEXT_CACHE_NONE;
+	cursor_text_edited = (HUITextCacheRef) {0};
+	text_cache_stats = (HUITextCacheStats) { .budget = text_cache_stats.budget };
+}
+
+// How many glyphs start and end before offset in the text of the entry, and the offset where the
+// last of them ends, as populate_cache decodes them. Constant time when there is one glyph per byte.
+usize text_glyphs_before(HUITextCacheValue* value, usize offset, usize* end) {
+	if (offset > value->text.len) offset = value->text.len;
+	if (value->glyphs.len == value->text.len) {
+		*end = offset;
+		return offset;
+	}
+	char* text = value->text.data;
+	usize glyphs = 0;
+	usize i = 0;
+	while (i < value->text.len) {
+		int codepoint_bytes = 1;
+		if ((u8)text[i] >= 128) GetCodepoint(&text[i], &codepoint_bytes);
+		if (i + codepoint_bytes > offset) break;
+		i += codepoint_bytes;
+		glyphs++;
+	}
+	*end = i;
+	return glyphs;
+}
+
+// Lays out the text in the slot, which is already linked in the LRU list.
+// previous, if not NULL, is an entry of the same key laid out for this width, usually the same text
+// before an edit: the glyphs before the first byte that changed are kept from it, and only the rest
+// is laid out again. Its widths are kept, which may be narrower than needed but never wrong.
+// previous can be the entry itself, then the glyphs kept are not even copied.
+void populate_cache(HUITextCacheValue* value, str text, Pixels first_line_indent, Pixels width, HUIFont font, Pixels font_size, HUITextCacheValue* previous) {
+	Pixels x = first_line_indent;
+	Pixels y = 0;
+	Pixels min_width = -INFINITY;
+	Pixels max_width = INFINITY;
+	Pixels* ascii_advances = advance_table(font, font_size);
+	f64 spacing = font_size*0.1; // Added in double precision, as it always was
+
+	usize kept = 0;
+	usize start = 0; // The first byte laid out
+	if (previous != NULL) {
+		usize common = 0;
+		usize common_max = text.len < previous->text.len ? text.len : previous->text.len;
+		char* previous_text = previous->text.data;
+		while (common < common_max && previous_text[common] == text.data[common]) common++;
+		// An invalid UTF-8 sequence decodes differently depending on the next bytes
+		common = common > 3 ? common - 3 : 0;
+		kept = text_glyphs_before(previous, common, &start);
 	}
 
-	BeginTextureMode(values[index].texture);
-	BeginScissorMode(0, 0, width, tentative_height); // TODO: More than 100
-	ClearBackground((Color){0,0,0,0});
-	int codepoint_bytes = 0;
-	for (usize i = 0; i < text.len; i += codepoint_bytes) {
-		int chr = GetCodepoint(&text.data[i], &codepoint_bytes);
-		int index = GetGlyphIndex(font, chr);
-		Pixels chr_width = font.glyphs[index].advanceX ? font.glyphs[index].advanceX : font.recs[index].width;
-		chr_width *= scale_factor;
+	if (!value->used) {
+		value->glyphs = hvec_new(sizeof(HUIGlyphPosition));
+		value->text = hvec_new(sizeof(char));
+	}
+	hvec_clear(&value->text);
+	hvec_extend(&value->text, text.data, text.len);
+	if (value != previous) {
+		hvec_clear(&value->glyphs);
+		hvec_extend(&value->glyphs, kept > 0 ? previous->glyphs.data : NULL, kept);
+	}
+	value->glyphs.len = kept;
+	hvec_extend(&value->glyphs, NULL, text.len - start); // At most one glyph per byte
+	HUIGlyphPosition* glyphs = value->glyphs.data;
+	usize glyphs_len = kept;
+	if (kept > 0) {
+		// Where the pen was after the last glyph kept, computed the same way as below
+		HUIGlyphPosition last = glyphs[kept - 1];
+		x = last.x;
+		y = last.y;
+		x += last.codepoint < 128 ? ascii_advances[last.codepoint] : backend.glyph_advance(backend_font(font), last.codepoint, font_size);
+		x += spacing;
+		min_width = previous->min_width;
+		max_width = previous->max_width;
+	}
+	int codepoint_bytes = 1;
+	for (usize i = start; i < text.len; i += codepoint_bytes) {
+		int chr = (u8)text.data[i];
+		Pixels chr_width;
+		if (chr < 128) {
+			codepoint_bytes = 1;
+			chr_width = ascii_advances[chr];
+		} else {
+			chr = GetCodepoint(&text.data[i], &codepoint_bytes);
+			chr_width = backend.glyph_advance(backend_font(font), chr, font_size);
+		}
 		if (x + chr_width > width) {
+			if (x + chr_width < max_width) max_width = x + chr_width;
 			x = 0;
 			y += font_size;
+		} else if (x + chr_width > min_width) {
+			min_width = x + chr_width;
 		}
-		DrawTextCodepoint(font, chr, (Vector2){ .x = x, .y = y }, font_size, WHITE);
+		glyphs[glyphs_len++] = (HUIGlyphPosition) { .x = x, .y = y, .codepoint = chr, .atlas_generation = 0 };
 		x += chr_width;
-		x += font_size*0.1;
-	}
-	EndScissorMode();
-	EndTextureMode();
-
-	Pixels height = y + font_size;
-	values[index].used = true;
-	values[index].last_frame = frame_num;
-	values[index].height = height;
-	values[index].next_glyph_x = x;
-	values[index].next_glyph_y = y;
-	if (y == 0) { // If we never wrapped
-		values[index].actual_width = x;
-	} else {
-		values[index].actual_width = width;
+		x += spacing;
 	}
-	keys[index].hash = text_hash;
-	keys[index].first_line_indent = first_line_indent;
-	keys[index].width = width;
-	keys[index].font_size = font_size;
-
-	return &values[index];
+	value->glyphs.len = glyphs_len;
+
+	value->used = true;
+	value->version = ++text_cache_version;
+	value->height = y + font_size;
+	value->next_glyph_x = x;
+	value->next_glyph_y = y;
+	value->min_width = min_width;
+	value->max_width = max_width;
+	value->wrapped = y != 0;
+	value->line_width = x;
+	usize bytes = sizeof(HUITextCacheValue) + value->text.cap*value->text.element_size + value->glyphs.cap*value->glyphs.element_size;
+	text_cache_stats.bytes += bytes - value->bytes;
+	value->bytes = bytes;
 }
 
-HUITextCacheValue text_render_cached(str text, Pixels first_line_indent, Pixels width, Pixels font_size) {
-	u64 text_hash = hash_str(text);
-	HUITextCacheKey key = {
-		.hash = text_hash,
-		.width = width,
-		.font_size = font_size,
-		.first_line_indent = first_line_indent,
-	};
-	u64 key_hash = hash_key(key);
-
-	bool found = false;
-	u64 index = key_hash % HUI_TEXT_CACHE_SIZE;
-	i64 current_frame = hui_get_frame_num();
-	for(usize safety = 0; safety < HUI_TEXT_CACHE_GIVE_UP; safety++) {
-		if (values[index].used && values[index].last_frame < current_frame-100) {
-			values[index].used = false;
-			UnloadRenderTexture(values[index].texture);
-			values[index].texture = (RenderTexture2D){0};
-		}
-		if (values[index].used && keys[index].hash == text_hash && keys[index].width == width && keys[index].font_size == font_size && keys[index].first_line_indent == first_line_indent) {
-			found = true;
-			break;
+// previous is passed on to populate_cache on a miss, if it was laid out with the same key and
+// the same line breaks as width would give it. If it was not used in this frame, it is also laid
+// out again in place, instead of a new entry.
+HUITextCacheValue* text_layout_cached(str text, u64 text_hash, Pixels first_line_indent, Pixels width, HUIFont font, Pixels font_size, HUITextCacheValue* previous) {
+	if (text_cache_entries.element_size == 0) {
+		text_cache_entries = hvec_new(sizeof(HUITextCacheValue*));
+		text_cache_free_slots = hvec_new(sizeof(u32));
+		hui_text_cache = hhashmap_new(sizeof(HUITextCacheKey), sizeof(u32), HKEYTYPE_DIRECT);
+	}
+	HUITextCacheKey key;
+	memset(&key, 0, sizeof(key)); // Any padding is hashed too
+	key.hash = text_hash;
+	key.font = font;
+	key.font_size = font_size;
+	key.first_line_indent = first_line_indent;
+
+	u32* found = hhashmap_get(&hui_text_cache, &key);
+	u32 first = found == NULL ? HUI_TEXT_CACHE_NONE : *found;
+	for (u32 slot = first; slot != HUI_TEXT_CACHE_NONE;) {
+		HUITextCacheValue* value = text_cache_entry(slot);
+		// Otherwise the hash collided, and both are kept
+		if (
+			width >= value->min_width && width < value->max_width
+			&& value->text.len == text.len && memcmp(value->text.data, text.data, text.len) == 0
+		) {
+			text_cache_stats.hits++;
+			text_cache_touch(slot);
+			return value;
 		}
-		index = (index+1) % HUI_TEXT_CACHE_SIZE;
+		slot = value->next_width;
 	}
-	HUITextCacheValue* value;
-	if (found) {
-		value = &values[index];
+
+	text_cache_stats.misses++;
+	if (previous != NULL && (
+		previous->key.font != font || previous->key.font_size != font_size || previous->key.first_line_indent != first_line_indent
+		|| width < previous->min_width || width >= previous->max_width
+	)) {
+		previous = NULL;
 	}
-	else {
-		value = populate_cache(text, text_hash, first_line_indent, width, font_size, key_hash);
+	u32 slot;
+	bool in_place = previous != NULL && previous->last_frame != hui_get_frame_num();
+	if (in_place) {
+		slot = previous->slot;
+		text_cache_remove(slot);
+		found = hhashmap_get(&hui_text_cache, &key); // It may have been in the same chain
+		first = found == NULL ? HUI_TEXT_CACHE_NONE : *found;
+	} else if (text_cache_free_slots.len > 0) {
+		slot = *(u32*)hvec_at(&text_cache_free_slots, text_cache_free_slots.len - 1);
+		text_cache_free_slots.len--;
+	} else {
+		slot = text_cache_entries.len;
+		HUITextCacheValue* new_value = malloc(sizeof(HUITextCacheValue));
+		*new_value = (HUITextCacheValue) { .used = false };
+		hvec_push(&text_cache_entries, &new_value);
 	}
+	HUITextCacheValue* value = text_cache_entry(slot);
+	memcpy(&value->key, &key, sizeof(key));
+	value->slot = slot;
+	value->next_width = first;
+	if (!in_place) value->bytes = 0;
 	value->last_frame = hui_get_frame_num();
-	return *value;
+	text_cache_link_newest(slot);
+	if (found != NULL) *found = slot;
+	else hhashmap_set(&hui_text_cache, &key, &slot);
+	populate_cache(value, text, first_line_indent, width, font, font_size, previous);
+	if (!in_place) text_cache_stats.entries++;
+	text_cache_trim();
+	return value;
+}
+
+// Wrapped text takes all of the width it was laid out in
+Pixels text_cache_width(HUITextCacheValue* value, Pixels width) {
+	return value->wrapped ? width : value->line_width;
+}
+
+HUITextCacheRef text_cache_ref(HUITextCacheValue* value) {
+	return (HUITextCacheRef) { .value = value, .version = value->version };
+}
+
+// Returns NULL if the entry was evicted or populated again since, or if there was none.
+// Unlike text_cache_deref, it does not count as a use of the entry.
+HUITextCacheValue* text_cache_peek(HUITextCacheRef ref) {
+	if (ref.value == NULL || !ref.value->used || ref.value->version != ref.version) return NULL;
+	return ref.value;
+}
+
+HUITextCacheValue* text_cache_deref(HUITextCacheRef ref) {
+	HUITextCacheValue* value = text_cache_peek(ref);
+	if (value != NULL) text_cache_touch(value->slot);
+	return value;
+}
+
+// Draws the glyphs in [from, to). Only the ones inside of clip (the bounding box of the element)
+// are looked up in the atlas, and rasterized if they were not already, see atlas_glyph.
+void draw_text_glyphs(HUITextCacheValue* cached_text, usize from, usize to, Pixels x, Pixels y, HUIFont font, Pixels font_size, Color color, Layout clip) {
+	HUIGlyphPosition* glyphs = cached_text->glyphs.data;
+	HUIAtlas* atlas = text_atlas();
+	for (usize i = from; i < to; i++) {
+		Pixels glyph_y = y + glyphs[i].y;
+		if (glyph_y >= clip.y + clip.height) break; // Lines only go down
+		if (glyph_y + font_size <= clip.y) continue;
+		if (glyphs[i].atlas_generation != atlas->generation) {
+			// If the atlas is cleared meanwhile, the glyphs already drawn are flushed with the old one
+			if (!atlas_glyph(atlas, font, glyphs[i].codepoint, font_size, &glyphs[i].glyph)) continue; // Not rasterized yet
+			glyphs[i].atlas_generation = atlas->generation;
+		}
+		atlas_draw_glyph(atlas, glyphs[i].glyph, (Vector2) { .x = x + glyphs[i].x, .y = glyph_y }, font_size, color);
+	}
 }
 
 typedef struct {
 	str text;
 	TextStyle style;
 	Pixels first_line_indent;
+	u64 hash; // Of text
+	HUITextCacheRef cached; // Set when measured
 } HUITextData;
 
-LayoutResult hui_text_layout(Element* element, void* data) {
-	LayoutResult result = LAYOUT_OK;
-	Layout* layout = &element->layout;
-	HUITextData text_data = *(HUITextData*)data;
-	str text = text_data.text;
-	TextStyle style = text_data.style;
-
-	Pixels width_limit;
+Size hui_text_measure(Element* element, Constraints constraints, void* data) {
+	(void) element;
+	HUITextData* text_data = data;
+	TextStyle style = text_data->style;
 
-	if(is_unset(layout->width)) {
-		width_limit = element->parent->layout.width;
-	} else {
-		width_limit = layout->width;
-	}
+	Pixels width_limit = constraints_width(constraints);
 
-	HUITextCacheValue cached_text = text_render_cached(text, text_data.first_line_indent, width_limit, style.font_size);
+	HUITextCacheValue* cached_text = text_layout_cached(text_data->text, text_data->hash, text_data->first_line_indent, width_limit, style.font, style.font_size, NULL);
+	text_data->cached = text_cache_ref(cached_text);
 
-	if (is_unset(layout->width)) {
-		layout->width = cached_text.actual_width;
-	}
-
-	if(is_unset(layout->height)) {
-		layout->height = cached_text.height;
-	}
-	return result;
+	return (Size) {
+		.width = is_unset(constraints.width) ? text_cache_width(cached_text, width_limit) : constraints.width,
+		.height = is_unset(constraints.height) ? cached_text->height : constraints.height,
+	};
 }
 
 void hui_text_draw(Element* element, void* data) {
-	HUITextData text_data = *(HUITextData*)data;
-	str text = text_data.text;
-	TextStyle style = text_data.style;
-
-	HUITextCacheValue cached_text = text_render_cached(text, text_data.first_line_indent, element->layout.width, style.font_size);
-	DrawTextureRec(
-		cached_text.texture.texture,
-		(Rectangle){.x = 0, .y = cached_text.texture.texture.height - cached_text.height, .width = element->layout.width, .height = -cached_text.height},
-		(Vector2){element->layout.x, element->layout.y},
-		style.color
-	);
+	HUITextData* text_data = data;
+	TextStyle style = text_data->style;
+	Layout* layout = hui_layout(element);
+	Layout* clip = hui_bounding_box(element);
+	if (!CheckCollisionRecs(*layout, *clip)) return;
+
+	HUITextCacheValue* cached_text = text_cache_deref(text_data->cached);
+	if (cached_text == NULL) {
+		cached_text = text_layout_cached(text_data->text, text_data->hash, text_data->first_line_indent, layout->width, style.font, style.font_size, NULL);
+	}
+	draw_text_glyphs(cached_text, 0, cached_text->glyphs.len, layout->x, layout->y, style.font, style.font_size, style.color, *clip);
 }
 
 void hui_text_ex(str text, TextStyle style, Pixels first_line_indent) {
-	Element* element = push_element(sizeof(HUITextData));
-	element->draw = hui_text_draw;
-	element->compute_layout = hui_text_layout;
+	Element* element = push_element(HUI_KIND_TEXT, sizeof(HUITextData));
 	*(HUITextData*)get_element_data(element) = (HUITextData){
 		.text = text,
 		.style = style,
 		.first_line_indent = first_line_indent,
+		.hash = hash_str(text),
+		.cached = {0},
 	};
 }
 
@@ -230,84 +553,79 @@ void hui_text(str text, TextStyle style) {
 	hui_text_ex(text, style, 0);
 }
 
+// The whole text is laid out as one entry, and the cursor is placed at the position of its glyph,
+// so moving the cursor does not lay out anything. When the text is edited, the new entry keeps the
+// glyphs of the last one laid out before the edit, see populate_cache.
 typedef struct {
 	str text;
 	TextStyle style;
 	usize cursor;
+	u64 hash; // Of text
+	HUITextCacheRef cached; // Set when measured
 } HUICursorTextData;
 
-Pixels max(Pixels a, Pixels b) {
-	return a > b ? a : b;
-}
+#define HUI_CURSOR_BLINK_TIME 0.5 // Seconds it is shown, then hidden
 
-LayoutResult hui_cursor_text_layout(Element* element, void* data) {
-	LayoutResult result = LAYOUT_OK;
-	Layout* layout = &element->layout;
-	HUICursorTextData text_data = *(HUICursorTextData*)data;
-	str text = text_data.text;
-	TextStyle style = text_data.style;
-	usize cursor = text_data.cursor;
-
-	Pixels width_limit;
-
-	if(is_unset(layout->width)) {
-		width_limit = element->parent->layout.width;
-	} else {
-		width_limit = layout->width;
+HUITextCacheValue* cursor_text_layout(HUICursorTextData* text_data, Pixels width) {
+	TextStyle style = text_data->style;
+	HUITextCacheValue* previous = text_cache_peek(cursor_text_edited);
+	HUITextCacheValue* cached_text = text_layout_cached(text_data->text, text_data->hash, 0, width, style.font, style.font_size, previous);
+	if (cached_text->version == text_cache_version) { // Just laid out
+		cursor_text_edited = text_cache_ref(cached_text);
 	}
+	return cached_text;
+}
 
-	str before_cursor = str_slice(text, 0, cursor);
-	str after_cursor = str_slice(text, cursor, text.len);
-
-	HUITextCacheValue cached_before = text_render_cached(before_cursor, 0, width_limit, style.font_size);
-	HUITextCacheValue cached_after = text_render_cached(after_cursor, cached_before.next_glyph_x, width_limit, style.font_size);
+Size hui_cursor_text_measure(Element* element, Constraints constraints, void* data) {
+	(void) element;
+	HUICursorTextData* text_data = data;
 
-	if (is_unset(layout->width)) {
-		layout->width = max(cached_before.actual_width, cached_after.actual_width);
-	}
+	Pixels width_limit = constraints_width(constraints);
+	HUITextCacheValue* cached_text = cursor_text_layout(text_data, width_limit);
+	text_data->cached = text_cache_ref(cached_text);
 
-	if(is_unset(layout->height)) {
-		layout->height = cached_before.next_glyph_y + cached_after.height;
-	}
-	return result;
+	return (Size) {
+		.width = is_unset(constraints.width) ? text_cache_width(cached_text, width_limit) : constraints.width,
+		.height = is_unset(constraints.height) ? cached_text->height : constraints.height,
+	};
 }
 
 void hui_cursor_text_draw(Element* element, void* data) {
-	HUICursorTextData text_data = *(HUICursorTextData*)data;
-	str text = text_data.text;
-	TextStyle style = text_data.style;
-	usize cursor = text_data.cursor;
-
-	str before_cursor = str_slice(text, 0, cursor);
-	str after_cursor = str_slice(text, cursor, text.len);
-
-	HUITextCacheValue cached_before = text_render_cached(before_cursor, 0, element->layout.width, style.font_size);
-	HUITextCacheValue cached_after = text_render_cached(after_cursor, cached_before.next_glyph_x, element->layout.width, style.font_size);
-	DrawTextureRec(
-		cached_before.texture.texture,
-		(Rectangle){.x = 0, .y = cached_before.texture.texture.height - cached_before.height, .width = element->layout.width, .height = -cached_before.height},
-		(Vector2){element->layout.x, element->layout.y},
-		BLUE
-	);
-	DrawTextureRec(
-		cached_after.texture.texture,
-		(Rectangle){.x = 0, .y = cached_after.texture.texture.height - cached_after.height, .width = element->layout.width, .height = -cached_after.height},
-		(Vector2){element->layout.x, element->layout.y + cached_before.next_glyph_y},
-		RED
-	);
-
-	if (hui_get_frame_num() & 16) {
-		DrawRectangle(element->layout.x + cached_before.next_glyph_x, element->layout.y + cached_before.next_glyph_y, style.font_size/8, style.font_size, GREEN);
+	HUICursorTextData* text_data = data;
+	TextStyle style = text_data->style;
+	Layout* layout = hui_layout(element);
+	Layout* clip = hui_bounding_box(element);
+	if (!CheckCollisionRecs(*layout, *clip)) return;
+
+	HUITextCacheValue* cached_text = text_cache_deref(text_data->cached);
+	if (cached_text == NULL) {
+		cached_text = cursor_text_layout(text_data, layout->width);
+	}
+	usize cursor_end;
+	usize cursor = text_glyphs_before(cached_text, text_data->cursor, &cursor_end);
+	usize glyphs_len = cached_text->glyphs.len;
+	draw_text_glyphs(cached_text, 0, cursor, layout->x, layout->y, style.font, style.font_size, BLUE, *clip);
+	draw_text_glyphs(cached_text, cursor, glyphs_len, layout->x, layout->y, style.font, style.font_size, RED, *clip);
+
+	// It blinks on the clock, so frames are only needed when it changes, see hui_wait
+	f64 time = hui_get_time();
+	i64 blinks = time / HUI_CURSOR_BLINK_TIME;
+	hui_request_redraw_in((blinks + 1) * HUI_CURSOR_BLINK_TIME - time);
+	if (blinks % 2 == 0) {
+		HUIGlyphPosition* glyphs = cached_text->glyphs.data;
+		Pixels cursor_x = cursor < glyphs_len ? glyphs[cursor].x : cached_text->next_glyph_x;
+		Pixels cursor_y = cursor < glyphs_len ? glyphs[cursor].y : cached_text->next_glyph_y;
+		hui_draw_rectangle((Rectangle){ .x = layout->x + cursor_x, .y = layout->y + cursor_y, .width = style.font_size/8, .height = style.font_size }, GREEN);
 	}
 }
 
 void hui_cursor_text(str text, TextStyle style, usize cursor) {
-	Element* element = push_element(sizeof(HUITextData));
-	element->draw = hui_cursor_text_draw;
-	element->compute_layout = hui_cursor_text_layout;
+	Element* element = push_element(HUI_KIND_CURSOR_TEXT, sizeof(HUICursorTextData));
 	*(HUICursorTextData*)get_element_data(element) = (HUICursorTextData){
 		.text = text,
 		.style = style,
-		.cursor = cursor
+		.cursor = cursor,
+		.hash = hash_str(text),
+		.cached = {0},
 	};
 }
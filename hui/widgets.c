@@ -4,22 +4,22 @@
 #include <raylib.h>
 
 ElementId button_clicked = 0;
+i64 button_clicked_frame = 0; // Clicks are returned by the next frame's hui_button
 
 void hui_button_handle(Element* el, void* data) {
 	(void) data;
-	Vector2 mouse = GetMousePosition();
-	if (CheckCollisionPointRec(mouse, el->layout) && CheckCollisionPointRec(mouse, *el->bounding_box)) {
+	if (hui_hovered(el)) {
 		hot_id = el->id;
-		if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+		if (frame_input.mouse_pressed) {
 			active_id = el->id;
 		}
 	} else {
 		if(hot_id == el->id) hot_id = 0;
 	}
-	if (button_clicked == el->id) button_clicked = 0;
-	if (active_id == el->id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+	if (active_id == el->id && frame_input.mouse_released) {
 		if(hot_id == el->id) {
 			button_clicked = el->id;
+			button_clicked_frame = frame_num;
 		}
 		active_id = 0;
 	}
@@ -41,11 +41,11 @@ bool hui_button(ElementId id, str text, TextStyle style) {
 	hui_box_start(box_style);
 		Element* box = current_element();
 		box->id = id;
-		push_handler(hui_button_handle, box);
+		push_hover_handler(hui_button_handle, box);
 		hui_text(text, style);
 	hui_box_end();
 
-	return button_clicked == id;
+	return button_clicked == id && button_clicked_frame + 1 == frame_num;
 }
 
 
@@ -53,27 +53,22 @@ usize* active_text_input_cursor = NULL;
 usize* hot_text_input_cursor = NULL;
 u64 active_text_input_last_key_pressed = 0;
 
-bool is_key_pressed_with_repetition(int key) {
-	return IsKeyPressed(key) || IsKeyPressedRepeat(key);
-}
-
 void hui_text_input_handle(Element* el, void* data) {
 	(void) data;
 	strb* builder = (strb*)el->id;
 
-	Vector2 mouse = GetMousePosition();
-	if (CheckCollisionPointRec(mouse, el->layout) && CheckCollisionPointRec(mouse, *el->bounding_box)) {
+	if (hui_hovered(el)) {
 		hot_id = el->id;
-		if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+		if (frame_input.mouse_pressed) {
 			active_id = el->id;
 			active_text_input_cursor = hot_text_input_cursor;
 		}
 	} else {
 		if(hot_id == el->id) hot_id = 0;
-		if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && active_id == el->id) active_id = 0;
+		if (frame_input.mouse_pressed && active_id == el->id) active_id = 0;
 	}
 	if (active_id == el->id) {
-		int key = GetCharPressed();
+		int key = frame_input.char_pressed;
 		usize* cursor = active_text_input_cursor;
 		if (*cursor > builder->len) {
 			*cursor = builder->len;
@@ -88,18 +83,18 @@ void hui_text_input_handle(Element* el, void* data) {
 				(*cursor)++;
 			}
 		}
-		if (is_key_pressed_with_repetition(KEY_BACKSPACE) && builder->len > 0 && *cursor > 0) {
+		if ((frame_input.keys & HUI_KEY_BACKSPACE) && builder->len > 0 && *cursor > 0) {
 			strb_remove_char(builder, *cursor - 1);
 			(*cursor)--;
 		}
-		else if (is_key_pressed_with_repetition(KEY_LEFT) && *cursor > 0) {
+		else if ((frame_input.keys & HUI_KEY_LEFT) && *cursor > 0) {
 			(*cursor)--;
 		}
-		else if (is_key_pressed_with_repetition(KEY_RIGHT) && *cursor < builder->len) {
+		else if ((frame_input.keys & HUI_KEY_RIGHT) && *cursor < builder->len) {
 			(*cursor)++;
 		}
 
-		active_text_input_last_key_pressed = GetKeyPressed();
+		active_text_input_last_key_pressed = frame_input.key_pressed;
 	}
 }
 
@@ -121,7 +116,7 @@ u64 hui_text_input(strb* builder, usize* cursor, TextStyle style) {
 	hui_box_start(box_style);
 		Element* box = current_element();
 		box->id = (u64)builder;
-		push_handler(hui_text_input_handle, box);
+		push_hover_handler(hui_text_input_handle, box);
 
 		str view = str_from_strb(builder);
 		if (active_id == (u64)builder) {
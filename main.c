@@ -28,6 +28,7 @@ i32 main(void) {
 	};
 	text = strb_new();
 	while(!WindowShouldClose()) {
+		hui_wait();
 		BeginDrawing();
 			ClearBackground(RAYWHITE);
 			hui_root_start();
@@ -87,13 +88,15 @@ i32 main(void) {
 											hui_text(STR("Element"), text_style);
 										hui_box_end();
 									}
-								char buf2[32];
-								snprintf(buf2, sizeof(buf2), "Text cache used: %li/%li", hui_get_text_cache_used(), hui_get_text_cache_cap());
+								HUITextCacheStats cache_stats = hui_get_text_cache_stats();
+								char buf2[64];
+								snprintf(buf2, sizeof(buf2), "Text cache: %li entries, %li/%li KiB", cache_stats.entries, cache_stats.bytes/1024, cache_stats.budget/1024);
 								hui_text(str_from_cstr(buf2), text_style);
 								hui_cluster_end();
 							hui_cluster_end();
 						hui_cluster_end();
 						hui_block();
+						if (hui_memo_start(100, (u64)(text_style.font_size * 1000))) {
 						hui_stack_start(10);
 							hui_center_start(10);
 								hui_box_start(box_style);
@@ -119,6 +122,8 @@ i32 main(void) {
 							hui_box_end();
 							hui_text(STR("Hello, World!"), text_style);
 						hui_stack_end();
+						}
+						hui_memo_end();
 						hui_block();
 						hui_text(lorem, text_style);
 					hui_stack_end();
@@ -0,0 +1,87 @@
+// Chains of boxes, clusters, stacks and scrolls 10,000 deep, laid out and drawn on a thread with a
+// 1 MB stack, which is only enough if layout and drawing do not recurse on the C stack.
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <pthread.h>
+#include <stdio.h>
+
+#define DEPTH 10000
+#define STACK_SIZE (1 << 20)
+
+typedef enum {
+	CHAIN_BOX,
+	CHAIN_CLUSTER,
+	CHAIN_STACK,
+	CHAIN_SCROLL,
+	CHAIN_COUNT,
+} Chain;
+
+const char* chain_names[CHAIN_COUNT] = { "box", "cluster", "stack", "scroll" };
+Pixels offsets[DEPTH] = {0};
+bool failed = false;
+
+void chain_start(Chain chain, i32 i) {
+	switch (chain) {
+		case CHAIN_BOX: hui_box_start((BoxStyle) { .padding = msymmetric(1) }); break;
+		case CHAIN_CLUSTER: hui_cluster_start(0); break;
+		case CHAIN_STACK: hui_stack_start(0); break;
+		case CHAIN_SCROLL: hui_scroll_start(&offsets[i]); break;
+		case CHAIN_COUNT: break;
+	}
+}
+
+void chain_end(Chain chain) {
+	switch (chain) {
+		case CHAIN_BOX: hui_box_end(); break;
+		case CHAIN_CLUSTER: hui_cluster_end(); break;
+		case CHAIN_STACK: hui_stack_end(); break;
+		case CHAIN_SCROLL: hui_scroll_end(); break;
+		case CHAIN_COUNT: break;
+	}
+}
+
+void test_chain(Chain chain) {
+	Element* leaf = NULL;
+	for (i32 frame = 0; frame < 2; frame++) {
+		hui_root_start();
+			for (i32 i = 0; i < DEPTH; i++) chain_start(chain, i);
+			hui_fixed_start(20, 20);
+				leaf = current_element();
+				hui_block();
+			hui_fixed_end();
+			for (i32 i = 0; i < DEPTH; i++) chain_end(chain);
+		hui_root_end();
+	}
+
+	// Only the boxes have padding, of 1 on each side
+	Pixels position = chain == CHAIN_BOX ? DEPTH : 0;
+	Layout* layout = hui_layout(leaf);
+	if (layout->x != position || layout->y != position || layout->width != 20 || layout->height != 20) {
+		printf("FAIL %s: leaf at %.0f,%.0f %.0fx%.0f\n", chain_names[chain], layout->x, layout->y, layout->width, layout->height);
+		failed = true;
+		return;
+	}
+	printf("ok %s chain of %d\n", chain_names[chain], DEPTH);
+}
+
+void* run(void* data) {
+	(void) data;
+	for (Chain chain = 0; chain < CHAIN_COUNT; chain++) test_chain(chain);
+	return NULL;
+}
+
+i32 main(void) {
+	hui_set_backend(hui_null_backend(800, 600));
+	hui_init();
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, STACK_SIZE);
+	pthread_t thread;
+	if (pthread_create(&thread, &attr, run, NULL) != 0) panic("Could not create the thread");
+	pthread_join(thread, NULL);
+	pthread_attr_destroy(&attr);
+
+	hui_deinit();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+// Sizes of elements that depend on the constraints their parents pass down, on the null backend.
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <stdio.h>
+
+#define SCREEN_HEIGHT 600
+
+bool failed = false;
+Pixels offset = 0;
+HUIVirtualList list = {0};
+
+void build_item(usize index, void* user) {
+	(void) index;
+	(void) user;
+	hui_fixed_start(100, 20);
+		hui_block();
+	hui_fixed_end();
+}
+
+// The height of a leftright in a stack is unset, so its children get the stack's maximum height.
+// A virtual list takes all of it.
+void test_scroll_in_leftright() {
+	Element* scroll = NULL;
+	for (i32 frame = 0; frame < 2; frame++) {
+		hui_root_start();
+			hui_stack_start(0);
+				hui_leftright_start(0);
+					hui_scroll_start(&offset);
+						scroll = current_element();
+						hui_virtual_list(&list, 100, 20, 0, build_item, NULL);
+					hui_scroll_end();
+					hui_fixed_start(20, 20);
+						hui_block();
+					hui_fixed_end();
+				hui_leftright_end();
+			hui_stack_end();
+		hui_root_end();
+	}
+	Layout* layout = hui_layout(scroll);
+	if (layout->height != SCREEN_HEIGHT) {
+		printf("FAIL scroll in leftright: height %.0f instead of %d\n", layout->height, SCREEN_HEIGHT);
+		failed = true;
+		return;
+	}
+	printf("ok scroll in leftright\n");
+}
+
+i32 main(void) {
+	hui_set_backend(hui_null_backend(800, SCREEN_HEIGHT));
+	hui_init();
+
+	test_scroll_in_leftright();
+
+	hui_virtual_list_free(&list);
+	hui_deinit();
+	return failed ? 1 : 0;
+}
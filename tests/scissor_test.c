@@ -0,0 +1,61 @@
+// Virtual lists, empty or not, next to a scroll, on the null backend with its scissor calls
+// recorded: each frame must end without a scissor, or the next frames would be clipped by it.
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <stdio.h>
+
+bool scissor = false; // Of the backend
+bool failed = false;
+Pixels offset = 0;
+HUIVirtualList list = {0};
+
+void record_begin_scissor(Rectangle rect) {
+	(void) rect;
+	scissor = true;
+}
+
+void record_end_scissor() {
+	scissor = false;
+}
+
+void build_item(usize index, void* user) {
+	(void) index;
+	(void) user;
+	hui_fixed_start(100, 20);
+		hui_block();
+	hui_fixed_end();
+}
+
+void check(const char* name, usize count) {
+	for (i32 frame = 0; frame < 2; frame++) {
+		hui_root_start();
+			hui_stack_start(0);
+				hui_scroll_start(&offset);
+					build_item(0, NULL);
+				hui_scroll_end();
+				hui_virtual_list(&list, count, 20, 0, build_item, NULL);
+			hui_stack_end();
+		hui_root_end();
+	}
+	if (scissor) {
+		printf("FAIL %s: the frame ended with a scissor\n", name);
+		failed = true;
+		return;
+	}
+	printf("ok %s\n", name);
+}
+
+i32 main(void) {
+	HUIBackend backend = hui_null_backend(800, 600);
+	backend.begin_scissor = record_begin_scissor;
+	backend.end_scissor = record_end_scissor;
+	hui_set_backend(backend);
+	hui_init();
+
+	check("empty virtual list", 0);
+	check("virtual list of 100", 100);
+
+	hui_virtual_list_free(&list);
+	hui_deinit();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+// A key pressed while a frame is drawn, in idle mode, must reach the next frame. On the null backend,
+// with a key queued like raylib does: kept until it is read, and dropped when events are polled again.
+#include "../hui/hui.h"
+#include "../hlib/core.h"
+#include <stdio.h>
+
+#define KEY 'a'
+#define PRESSED_FRAME 1 // The first frame asks for another one, as the mouse moved
+#define FRAMES 3
+
+HUIBackend null_backend;
+int queued_key = 0;
+i32 frame = 0;
+int seen_keys[FRAMES] = {0};
+
+void queued_input(HUIInput* input) {
+	null_backend.input(input);
+	input->key_pressed = queued_key;
+	queued_key = 0;
+}
+
+bool polling_wait_events(f64 timeout) {
+	queued_key = 0;
+	return null_backend.wait_events(timeout);
+}
+
+// Runs after the frame read its input, like the backend polling the next frame's during drawing
+void press_key(Element* el, void* data) {
+	(void) el;
+	(void) data;
+	seen_keys[frame] = hui_get_input().key_pressed;
+	if (frame == PRESSED_FRAME) queued_key = KEY;
+}
+
+i32 main(void) {
+	null_backend = hui_null_backend(800, 600);
+	HUIBackend backend = null_backend;
+	backend.input = queued_input;
+	backend.wait_events = polling_wait_events;
+	hui_set_backend(backend);
+	hui_init();
+
+	for (frame = 0; frame < FRAMES; frame++) {
+		hui_wait();
+		hui_root_start();
+			hui_fixed_start(20, 20);
+				push_handler(press_key, current_element());
+				hui_block();
+			hui_fixed_end();
+		hui_root_end();
+	}
+
+	hui_deinit();
+	if (seen_keys[PRESSED_FRAME + 1] != KEY) {
+		printf("FAIL key pressed while drawing: the next frame saw %d instead of %d\n", seen_keys[PRESSED_FRAME + 1], KEY);
+		return 1;
+	}
+	printf("ok key pressed while drawing\n");
+	return 0;
+}
@@ -30,6 +30,7 @@ i32 main(void) {
 		.font_size = 20,
 	};
 	while(!WindowShouldClose()) {
+		hui_wait();
 		BeginDrawing();
 			ClearBackground(RAYWHITE);
 			hui_root_start();